@@ -0,0 +1,89 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+
+#include <array>
+#include <atomic>
+
+#include "move.h"
+
+namespace stormphrax::search {
+    // Simplified ABDADA: a small shared table of (position, move) pairs that
+    // some thread is currently searching. Other threads defer those moves to
+    // the end of their move loop, so they split sibling subtrees between them
+    // instead of all searching the same one. Lossy by design - a collision
+    // only costs a move being searched in the usual order
+    class AbdadaTable {
+    public:
+        // 256 KiB
+        static constexpr usize kEntries = 32768;
+
+        [[nodiscard]] static constexpr u64 moveKey(u64 posKey, Move move) {
+            return posKey ^ (static_cast<u64>(move.data()) * 0x9e3779b97f4a7c15);
+        }
+
+        [[nodiscard]] inline bool busy(u64 key) const {
+            return m_entries[index(key)].load(std::memory_order::relaxed) == key;
+        }
+
+        inline void enter(u64 key) {
+            m_entries[index(key)].store(key, std::memory_order::relaxed);
+        }
+
+        inline void leave(u64 key) {
+            // leave the slot alone if another pair has since taken it over
+            auto expected = key;
+            m_entries[index(key)].compare_exchange_strong(expected, 0, std::memory_order::relaxed);
+        }
+
+    private:
+        [[nodiscard]] static constexpr usize index(u64 key) {
+            return key % kEntries;
+        }
+
+        std::array<std::atomic<u64>, kEntries> m_entries{};
+    };
+
+    // Marks a move as being searched for the lifetime of the guard,
+    // does nothing if constructed with a null table
+    class AbdadaGuard {
+    public:
+        AbdadaGuard(AbdadaTable* table, u64 key) :
+                m_table{table}, m_key{key} {
+            if (m_table) {
+                m_table->enter(m_key);
+            }
+        }
+
+        AbdadaGuard(const AbdadaGuard&) = delete;
+        AbdadaGuard(AbdadaGuard&&) = delete;
+
+        inline ~AbdadaGuard() {
+            if (m_table) {
+                m_table->leave(m_key);
+            }
+        }
+
+    private:
+        AbdadaTable* m_table;
+        u64 m_key;
+    };
+} // namespace stormphrax::search
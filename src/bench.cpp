@@ -18,19 +18,32 @@
 
 #include "bench.h"
 
+#include <algorithm>
 #include <array>
-
-#if SP_SPARSE_BENCH_FT_SIZE > 0
-    #include <fmt/ostream.h>
-    #include <fstream>
-#endif
+#include <cmath>
+#include <fmt/ostream.h>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "position/position.h"
+#include "profiler.h"
 #include "stats.h"
+#include "ttable.h"
+#include "util/parse.h"
+#include "util/perf_counters.h"
+#include "util/rng.h"
+#include "util/split.h"
+#include "util/timer.h"
 
 namespace stormphrax::bench {
-    void run(search::Searcher& searcher, i32 depth) {
-        static constexpr std::array kStandardFens = {
+    namespace {
+        constexpr std::array kStandardFens = {
             // fens from alexandria, ultimately from bitgenie
             "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq - 0 14",
             "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
@@ -84,47 +97,386 @@ namespace stormphrax::bench {
             "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93",
         };
 
-        static constexpr std::array kFrcFens = {
+        constexpr std::array kFrcFens = {
             // from SF
             "bb1n1rkr/ppp1Q1pp/3n1p2/3p4/3P4/6Pq/PPP1PP1P/BB1NNRKR w HFhf - 0 5",
             "nqbnrkrb/pppppppp/8/8/8/8/PPPPPPPP/NQBNRKRB w GEge - 0 1",
         };
 
-        const auto prevChess960 = g_opts.chess960;
+        // runs f on the standard bench positions, then the FRC ones with UCI_Chess960 set
+        template <typename F>
+        void forEachPosition(F&& f) {
+            const auto prevChess960 = g_opts.chess960;
 
-        searcher.newGame();
+            opts::mutableOpts().chess960 = false;
 
-        usize nodes{};
-        f64 time{};
+            for (const auto& fen : kStandardFens) {
+                f(*Position::fromFen(fen));
+            }
 
-        const auto benchPosition = [&](const Position& pos) {
-            search::BenchData data{};
-            searcher.runBench(data, pos, depth);
+            opts::mutableOpts().chess960 = true;
 
-            nodes += data.search.nodes;
-            time += data.time;
+            for (const auto& fen : kFrcFens) {
+                f(*Position::fromFen(fen));
+            }
+
+            opts::mutableOpts().chess960 = prevChess960;
+        }
+
+        struct BenchPosition {
+            std::string fen;
+            bool chess960;
         };
 
-        opts::mutableOpts().chess960 = false;
+        // fens and the strings json escapes matter for are plain ascii
+        std::string jsonEscape(std::string_view str) {
+            std::string escaped{};
+            escaped.reserve(str.size());
+
+            for (const auto c : str) {
+                if (c == '"' || c == '\\') {
+                    escaped += '\\';
+                }
+                escaped += c;
+            }
+
+            return escaped;
+        }
+
+        void writeBenchJson(
+            const std::string& path,
+            const BenchConfig& config,
+            std::span<const BenchPosition> positions,
+            std::span<const usize> positionNodes,
+            std::span<const f64> positionTimes,
+            std::span<const usize> repNodes,
+            std::span<const f64> repTimes,
+            std::span<const f64> repNps,
+            bool nodesConsistent
+        ) {
+            std::ofstream stream{path};
+
+            if (!stream) {
+                eprintln("failed to open {}", path);
+                return;
+            }
+
+            const auto reps = repTimes.size();
+            const auto nps = summarize(repNps);
+            const auto time = summarize(repTimes);
+
+            const auto optionalValue = [](const auto& value) {
+                return value ? fmt::format("{}", *value) : std::string{"null"};
+            };
+
+            fmt::println(stream, "{{");
+            fmt::println(stream, "  \"depth\": {},", config.nodes ? std::string{"null"} : fmt::format("{}", config.depth));
+            fmt::println(stream, "  \"nodes_limit\": {},", optionalValue(config.nodes));
+            fmt::println(stream, "  \"reps\": {},", reps);
+            fmt::println(stream, "  \"threads\": {},", config.threads);
+            fmt::println(
+                stream,
+                "  \"fen_file\": {},",
+                config.fenFile ? fmt::format("\"{}\"", jsonEscape(*config.fenFile)) : std::string{"null"}
+            );
+            fmt::println(stream, "  \"signature\": {},", repNodes[0]);
+            fmt::println(stream, "  \"nodes_consistent\": {},", nodesConsistent);
+            fmt::println(
+                stream,
+                "  \"time\": {{\"mean\": {:.6f}, \"median\": {:.6f}, \"stddev\": {:.6f}, \"min\": {:.6f}, \"max\": {:.6f}}},",
+                time.mean,
+                time.median,
+                time.stddev,
+                time.min,
+                time.max
+            );
+            fmt::println(
+                stream,
+                "  \"nps\": {{\"mean\": {:.0f}, \"median\": {:.0f}, \"stddev\": {:.0f}, \"min\": {:.0f}, \"max\": {:.0f}}},",
+                nps.mean,
+                nps.median,
+                nps.stddev,
+                nps.min,
+                nps.max
+            );
 
-        for (const auto& fen : kStandardFens) {
-            const auto pos = *Position::fromFen(fen);
-            benchPosition(pos);
+            fmt::println(stream, "  \"runs\": [");
+            for (usize rep = 0; rep < reps; ++rep) {
+                fmt::println(
+                    stream,
+                    "    {{\"nodes\": {}, \"time\": {:.6f}, \"nps\": {:.0f}}}{}",
+                    repNodes[rep],
+                    repTimes[rep],
+                    repNps[rep],
+                    rep + 1 < reps ? "," : ""
+                );
+            }
+            fmt::println(stream, "  ],");
+
+            fmt::println(stream, "  \"positions\": [");
+            for (usize i = 0; i < positions.size(); ++i) {
+                fmt::println(
+                    stream,
+                    "    {{\"fen\": \"{}\", \"chess960\": {}, \"nodes\": {}, \"time\": {:.6f}}}{}",
+                    jsonEscape(positions[i].fen),
+                    positions[i].chess960,
+                    positionNodes[i] / reps,
+                    positionTimes[i] / static_cast<f64>(reps),
+                    i + 1 < positions.size() ? "," : ""
+                );
+            }
+            fmt::println(stream, "  ]");
+            fmt::println(stream, "}}");
+
+            println("info string wrote bench results to {}", path);
+        }
+    } // namespace
+
+    Summary summarize(std::span<const f64> values) {
+        assert(!values.empty());
+
+        std::vector<f64> sorted(values.begin(), values.end());
+        std::ranges::sort(sorted);
+
+        const auto count = sorted.size();
+
+        f64 mean{};
+        for (const auto v : sorted) {
+            mean += v;
+        }
+        mean /= static_cast<f64>(count);
+
+        f64 variance{};
+        for (const auto v : sorted) {
+            variance += (v - mean) * (v - mean);
         }
 
-        opts::mutableOpts().chess960 = true;
+        if (count > 1) {
+            variance /= static_cast<f64>(count - 1);
+        }
+
+        const auto median = count % 2 == 1 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0;
+
+        return {mean, median, std::sqrt(variance), sorted.front(), sorted.back()};
+    }
+
+    std::span<const char* const> standardFens() {
+        return kStandardFens;
+    }
+
+    std::optional<std::vector<std::string>> loadFens(const std::string& path) {
+        std::ifstream stream{path};
+
+        if (!stream) {
+            eprintln("failed to open {}", path);
+            return {};
+        }
+
+        std::vector<std::string> fens{};
+
+        for (std::string line{}; std::getline(stream, line);) {
+            std::vector<std::string_view> parts{};
+            split::split(parts, line, ' ');
+
+            if (parts.size() < 4) {
+                continue;
+            }
+
+            // EPD operations follow the first four fields, keep the move counters if present
+            auto fen = fmt::format("{} {} {} {}", parts[0], parts[1], parts[2], parts[3]);
+
+            if (parts.size() >= 6 && util::tryParse<u32>(parts[4]) && util::tryParse<u32>(parts[5])) {
+                fen += fmt::format(" {} {}", parts[4], parts[5]);
+            }
 
-        for (const auto& fen : kFrcFens) {
-            const auto pos = *Position::fromFen(fen);
-            benchPosition(pos);
+            fens.push_back(std::move(fen));
         }
 
+        return fens;
+    }
+
+    void run(search::Searcher& searcher, i32 depth) {
+        BenchConfig config{};
+        config.depth = depth;
+
+        run(searcher, config);
+    }
+
+    void run(search::Searcher& searcher, const BenchConfig& config) {
+        const auto prevChess960 = g_opts.chess960;
+
+        std::vector<BenchPosition> positions{};
+
+        if (config.fenFile) {
+            auto fens = loadFens(*config.fenFile);
+
+            if (!fens) {
+                return;
+            }
+
+            for (auto& fen : *fens) {
+                positions.push_back({std::move(fen), prevChess960});
+            }
+        } else {
+            for (const auto fen : kStandardFens) {
+                positions.push_back({fen, false});
+            }
+
+            for (const auto fen : kFrcFens) {
+                positions.push_back({fen, true});
+            }
+        }
+
+        std::vector<Position> roots{};
+        roots.reserve(positions.size());
+
+        for (const auto& position : positions) {
+            opts::mutableOpts().chess960 = position.chess960;
+
+            if (const auto pos = Position::fromFen(position.fen)) {
+                roots.push_back(*pos);
+            } else {
+                eprintln("invalid fen {}", position.fen);
+                opts::mutableOpts().chess960 = prevChess960;
+                return;
+            }
+        }
+
+        if (roots.empty()) {
+            eprintln("no positions to bench");
+            opts::mutableOpts().chess960 = prevChess960;
+            return;
+        }
+
+        const auto reps = std::max<u32>(config.reps, 1);
+        const auto threads = std::max<u32>(config.threads, 1);
+
+        // a node limit replaces the depth limit
+        const auto depth = config.nodes ? kMaxDepth : config.depth;
+
+        if (threads > 1) {
+            searcher.setThreads(threads);
+        }
+
+        stats::reset();
+        profiler::reset();
+
+        // summed over reps
+        std::vector<usize> positionNodes(roots.size());
+        std::vector<f64> positionTimes(roots.size());
+
+        std::vector<usize> repNodes{};
+        std::vector<f64> repTimes{};
+        std::vector<f64> repNps{};
+
+        bool nodesConsistent = true;
+
+        const auto startTicks = profiler::ticks();
+
+        for (u32 rep = 0; rep < reps; ++rep) {
+            // every rep starts from an empty TT and history, so single threaded
+            // reps search exactly the same tree and only their timing differs
+            searcher.newGame();
+
+            usize nodes{};
+            f64 time{};
+
+            for (usize i = 0; i < roots.size(); ++i) {
+                opts::mutableOpts().chess960 = positions[i].chess960;
+
+                search::BenchData data{};
+
+                if (threads > 1) {
+                    searcher.runSilentSearch(data, roots[i], depth, config.nodes);
+                } else {
+                    searcher.runBench(data, roots[i], depth, config.nodes);
+                }
+
+                const usize searchNodes = data.search.nodes;
+
+                if (rep > 0 && searchNodes * rep != positionNodes[i]) {
+                    nodesConsistent = false;
+                }
+
+                positionNodes[i] += searchNodes;
+                positionTimes[i] += data.time;
+
+                nodes += searchNodes;
+                time += data.time;
+            }
+
+            repNodes.push_back(nodes);
+            repTimes.push_back(time);
+            repNps.push_back(static_cast<f64>(nodes) / time);
+        }
+
+        const auto totalTicks = profiler::ticks() - startTicks;
+
         opts::mutableOpts().chess960 = prevChess960;
 
-        println("info string {:.5g} seconds", time);
-        println("{} nodes {} nps", nodes, static_cast<usize>(static_cast<f64>(nodes) / time));
+        if (threads > 1) {
+            searcher.setThreads(opts::kThreadCountRange.clamp(g_opts.threads));
+        }
+
+        for (usize i = 0; i < roots.size(); ++i) {
+            println(
+                "info string bench position {} nodes {} time {:.4f}",
+                i + 1,
+                positionNodes[i] / reps,
+                positionTimes[i] / static_cast<f64>(reps)
+            );
+        }
+
+        const auto nps = summarize(repNps);
+        const auto time = summarize(repTimes);
+
+        println(
+            "info string bench reps {} threads {} nps_mean {:.0f} nps_median {:.0f} nps_stddev {:.0f} "
+            "nps_cv {:.3f} nps_min {:.0f} nps_max {:.0f}",
+            reps,
+            threads,
+            nps.mean,
+            nps.median,
+            nps.stddev,
+            nps.stddev / nps.mean,
+            nps.min,
+            nps.max
+        );
+
+        if (!nodesConsistent) {
+            if (threads > 1) {
+                println("info string node counts differ between reps, as expected with multiple threads");
+            } else {
+                println("info string warning: node counts differ between reps, search is nondeterministic");
+            }
+        }
+
+        usize totalNodes{};
+        for (const auto nodes : repNodes) {
+            totalNodes += nodes;
+        }
+
+        // the last two lines are the bench signature, parsed by OpenBench among others.
+        // nodes are from the first rep, nps is the median over reps
+        println("info string {:.5g} seconds", time.mean);
+        println("{} nodes {} nps", repNodes[0], static_cast<usize>(nps.median));
 
         stats::print();
+        profiler::print(totalNodes, totalTicks);
+
+        if (config.jsonFile) {
+            writeBenchJson(
+                *config.jsonFile,
+                config,
+                positions,
+                positionNodes,
+                positionTimes,
+                repNodes,
+                repTimes,
+                repNps,
+                nodesConsistent
+            );
+        }
 
 #if SP_SPARSE_BENCH_FT_SIZE > 0
         std::ofstream stream{"activations.txt", std::ios::binary};
@@ -143,4 +495,255 @@ namespace stormphrax::bench {
         println("Wrote FT activation counts to activations.txt");
 #endif
     }
+
+    void runPerf(search::Searcher& searcher, i32 depth) {
+        using util::PerfEvent;
+
+        util::PerfCounters counters{};
+
+        if (!counters.error().empty()) {
+            println("info string {}", counters.error());
+        }
+
+        if (!counters.anyAvailable()) {
+            println("info string no hardware counters available, only reporting nodes and time");
+        }
+
+        searcher.newGame();
+
+        usize positions{};
+        usize nodes{};
+        f64 time{};
+
+        // empty if the event was unavailable for any position
+        std::array<std::optional<u64>, util::kPerfEventCount> totals{};
+        totals.fill(0);
+
+        const auto perNode = [](std::optional<u64> count, usize nodeCount) -> std::string {
+            if (!count || nodeCount == 0) {
+                return "n/a";
+            }
+            return fmt::format("{:.3f}", static_cast<f64>(*count) / static_cast<f64>(nodeCount));
+        };
+
+        print("{:>4} {:>10}", "pos", "nodes");
+        for (usize i = 0; i < util::kPerfEventCount; ++i) {
+            print(" {:>14}", util::perfEventName(static_cast<PerfEvent>(i)));
+        }
+        println();
+
+        forEachPosition([&](const Position& pos) {
+            search::BenchData data{};
+
+            counters.start();
+            searcher.runBench(data, pos, depth);
+            counters.stop();
+
+            const auto counts = counters.read();
+            const usize positionNodes = data.search.nodes;
+
+            ++positions;
+            nodes += positionNodes;
+            time += data.time;
+
+            print("{:>4} {:>10}", positions, positionNodes);
+
+            for (usize i = 0; i < util::kPerfEventCount; ++i) {
+                print(" {:>14}", perNode(counts[i], positionNodes));
+
+                if (totals[i] && counts[i]) {
+                    *totals[i] += *counts[i];
+                } else {
+                    totals[i].reset();
+                }
+            }
+
+            println();
+        });
+
+        println("info string {:.5g} seconds", time);
+        println("{} nodes {} nps", nodes, static_cast<usize>(static_cast<f64>(nodes) / time));
+
+        println("{:<14} {:>16} {:>12} {:>16}", "event", "total", "per node", "per position");
+
+        for (usize i = 0; i < util::kPerfEventCount; ++i) {
+            const auto name = util::perfEventName(static_cast<PerfEvent>(i));
+
+            if (!totals[i]) {
+                println("{:<14} {:>16} {:>12} {:>16}", name, "n/a", "n/a", "n/a");
+                continue;
+            }
+
+            println(
+                "{:<14} {:>16} {:>12} {:>16.0f}",
+                name,
+                *totals[i],
+                perNode(totals[i], nodes),
+                static_cast<f64>(*totals[i]) / static_cast<f64>(positions)
+            );
+        }
+
+        const auto& cycles = totals[static_cast<usize>(PerfEvent::kCycles)];
+        const auto& instructions = totals[static_cast<usize>(PerfEvent::kInstructions)];
+
+        if (cycles && instructions && *cycles > 0) {
+            println("info string IPC {:.3f}", static_cast<f64>(*instructions) / static_cast<f64>(*cycles));
+        }
+    }
+
+    void runSmp(search::Searcher& searcher, const SmpBenchConfig& config) {
+        const auto prevChess960 = g_opts.chess960;
+        opts::mutableOpts().chess960 = false;
+
+        const auto reps = std::max<u32>(config.reps, 1);
+
+        // header and result lines are whitespace-separated key/value pairs
+        // after "info string smp", so they can be parsed like info lines
+        println(
+            "info string smp depth {} reps {} positions {} mode {} hardware_threads {}",
+            config.depth,
+            reps,
+            kStandardFens.size(),
+            g_opts.smpMode == opts::SmpMode::kAbdada ? "abdada" : "lazy",
+            std::thread::hardware_concurrency()
+        );
+
+        std::optional<f64> baseTime{};
+        std::optional<f64> baseNps{};
+
+        std::vector<f64> times{};
+        std::vector<f64> npses{};
+
+        for (const auto threadCount : config.threadCounts) {
+            searcher.setThreads(threadCount);
+
+            times.clear();
+            npses.clear();
+
+            usize totalNodes{};
+
+            for (u32 rep = 0; rep < reps; ++rep) {
+                // every rep starts from an empty TT, so reps are comparable
+                searcher.newGame();
+
+                usize nodes{};
+                f64 time{};
+
+                for (const auto& fen : kStandardFens) {
+                    const auto pos = *Position::fromFen(fen);
+
+                    search::BenchData data{};
+                    searcher.runSilentSearch(data, pos, config.depth);
+
+                    nodes += data.search.nodes;
+                    time += data.time;
+                }
+
+                totalNodes += nodes;
+
+                times.push_back(time);
+                npses.push_back(static_cast<f64>(nodes) / time);
+            }
+
+            const auto time = summarize(times);
+            const auto nps = summarize(npses);
+
+            if (!baseTime) {
+                baseTime = time.mean;
+                baseNps = nps.mean;
+            }
+
+            println(
+                "info string smp threads {} time {:.4f} time_stddev {:.4f} speedup {:.3f} "
+                "nodes {} nps {:.0f} nps_stddev {:.0f} nps_per_thread {:.0f} nps_scaling {:.3f}",
+                threadCount,
+                time.mean,
+                time.stddev,
+                *baseTime / time.mean,
+                totalNodes / reps,
+                nps.mean,
+                nps.stddev,
+                nps.mean / static_cast<f64>(threadCount),
+                nps.mean / *baseNps
+            );
+        }
+
+        searcher.setThreads(opts::kThreadCountRange.clamp(g_opts.threads));
+
+        opts::mutableOpts().chess960 = prevChess960;
+    }
+
+    void runTt(usize ttSizeMib, usize keyCount) {
+        TTable ttable{ttSizeMib};
+        ttable.finalize();
+
+        println(
+            "info string {} MiB TT, {} byte clusters with {} entries and {} bit keys",
+            ttSizeMib,
+            TTable::clusterSize(),
+            TTable::entriesPerCluster(),
+            TTable::keyBits()
+        );
+
+        util::rng::Jsf64Rng rng{0xdeadbeefcafebabe};
+
+        std::vector<u64> storedKeys(keyCount);
+        std::vector<u64> freshKeys(keyCount);
+
+        for (auto& key : storedKeys) {
+            key = rng.nextU64();
+        }
+
+        for (auto& key : freshKeys) {
+            key = rng.nextU64();
+        }
+
+        const auto nsPerOp = [keyCount](f64 time) {
+            return time * 1000000000.0 / static_cast<f64>(keyCount);
+        };
+
+        const auto percent = [keyCount](usize count) {
+            return static_cast<f64>(count) * 100.0 / static_cast<f64>(keyCount);
+        };
+
+        auto start = util::Instant::now();
+
+        for (const auto key : storedKeys) {
+            const auto depth = static_cast<i32>(key % 32);
+            const auto score = static_cast<Score>(key % 512) - 256;
+            ttable.put(key, score, score, kNullMove, depth, 0, TtFlag::kExact, false);
+        }
+
+        const auto putTime = start.elapsed();
+
+        usize hits{};
+        ProbedTTableEntry entry{};
+
+        start = util::Instant::now();
+
+        for (const auto key : storedKeys) {
+            hits += ttable.probe(entry, key, 0);
+        }
+
+        const auto storedProbeTime = start.elapsed();
+
+        usize falseHits{};
+
+        start = util::Instant::now();
+
+        for (const auto key : freshKeys) {
+            falseHits += ttable.probe(entry, key, 0);
+        }
+
+        const auto freshProbeTime = start.elapsed();
+
+        println("info string put: {:.1f} ns/op", nsPerOp(putTime));
+        println("info string probe (stored keys): {:.1f} ns/op, {:.2f}% hits", nsPerOp(storedProbeTime), percent(hits));
+        println(
+            "info string probe (fresh keys): {:.1f} ns/op, {:.5f}% false hits",
+            nsPerOp(freshProbeTime),
+            percent(falseHits)
+        );
+        println("info string hashfull {}", ttable.full());
+    }
 } // namespace stormphrax::bench
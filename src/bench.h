@@ -20,6 +20,12 @@
 
 #include "types.h"
 
+#include <array>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
 #include "search.h"
 
 namespace stormphrax::bench {
@@ -33,5 +39,64 @@ namespace stormphrax::bench {
 
     constexpr usize kDefaultBenchTtSize = 16;
 
+    constexpr i32 kDefaultSmpBenchDepth = 12;
+    constexpr u32 kDefaultSmpBenchReps = 3;
+    constexpr std::array<u32, 5> kDefaultSmpBenchThreadCounts{1, 2, 4, 8, 16};
+
+    // large enough that most accesses miss cache
+    constexpr usize kDefaultTtBenchSize = 1024;
+    constexpr usize kDefaultTtBenchKeys = 1 << 24;
+
+    // the standard (non-FRC) bench positions
+    [[nodiscard]] std::span<const char* const> standardFens();
+
+    // loads positions from an EPD or FEN file, one per line. EPD operations
+    // are dropped, move counters are kept if present
+    [[nodiscard]] std::optional<std::vector<std::string>> loadFens(const std::string& path);
+
+    struct Summary {
+        f64 mean;
+        f64 median;
+        f64 stddev;
+        f64 min;
+        f64 max;
+    };
+
+    // stddev is the sample standard deviation. values must not be empty
+    [[nodiscard]] Summary summarize(std::span<const f64> values);
+
+    struct BenchConfig {
+        i32 depth{kDefaultBenchDepth};
+        // if set, each position is searched to this many nodes instead of to depth
+        std::optional<usize> nodes{};
+        u32 reps{1};
+        u32 threads{1};
+        // positions to search instead of the builtin ones, in the current UCI_Chess960 mode
+        std::optional<std::string> fenFile{};
+        std::optional<std::string> jsonFile{};
+    };
+
+    // node counts are deterministic (and printed as the bench signature) for one thread.
+    // each rep starts from a fresh search state, NPS is reported over reps
+    void run(search::Searcher& searcher, const BenchConfig& config);
     void run(search::Searcher& searcher, i32 depth = kDefaultBenchDepth);
+
+    // bench with hardware counters (cycles, instructions, cache, TLB and branch
+    // misses) around each position, reported per node. Linux only, reports n/a
+    // for any counter that cannot be opened, e.g. due to perf_event_paranoid
+    void runPerf(search::Searcher& searcher, i32 depth = kDefaultBenchDepth);
+
+    struct SmpBenchConfig {
+        i32 depth{kDefaultSmpBenchDepth};
+        u32 reps{kDefaultSmpBenchReps};
+        std::vector<u32> threadCounts{};
+    };
+
+    // SMP scaling benchmark - real multithreaded searches of the standard bench
+    // positions to a fixed depth at each thread count, using the current SMPMode.
+    // speedup is time to depth relative to the first thread count
+    void runSmp(search::Searcher& searcher, const SmpBenchConfig& config);
+
+    // TT microbenchmark - put/probe throughput and false hit rate on random keys
+    void runTt(usize ttSizeMib = kDefaultTtBenchSize, usize keyCount = kDefaultTtBenchKeys);
 } // namespace stormphrax::bench
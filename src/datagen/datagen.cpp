@@ -72,6 +72,10 @@ namespace stormphrax::datagen {
                 return allowSoftTimeout && data.nodes >= m_softNodeLimit;
             }
 
+            [[nodiscard]] usize hardNodeLimit() const final {
+                return m_hardNodeLimit;
+            }
+
             [[nodiscard]] bool stopped() const final {
                 // doesn't matter
                 return false;
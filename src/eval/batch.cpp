@@ -0,0 +1,105 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "batch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#include "eval.h"
+
+namespace stormphrax::eval {
+    namespace {
+        // positions with equal keys share both refresh table entries and their output bucket
+        [[nodiscard]] u32 groupKey(const Position& pos) {
+            constexpr auto kEntries = InputFeatureSet::kRefreshTableSize;
+
+            const auto bbs = pos.bbs();
+            const auto kings = pos.kings();
+
+            const auto blackEntry = InputFeatureSet::getRefreshTableEntry(Color::kBlack, kings.black());
+            const auto whiteEntry = InputFeatureSet::getRefreshTableEntry(Color::kWhite, kings.white());
+
+            return (blackEntry * kEntries + whiteEntry) * OutputBucketing::kBucketCount
+                 + OutputBucketing::getBucket(bbs);
+        }
+
+        void evalSlice(std::span<const Position> positions, std::span<const u32> order, std::span<Score> evals) {
+            // too big for the stack
+            auto refreshTable = std::make_unique<RefreshTable>();
+            refreshTable->init(g_network->featureTransformer());
+
+            for (const auto idx : order) {
+                const auto& pos = positions[idx];
+
+                const auto eval = NnueState::evaluateWithTable(pos.bbs(), pos.kings(), pos.stm(), *refreshTable);
+                evals[idx] = adjustStatic<true>(pos, {}, eval);
+            }
+        }
+    } // namespace
+
+    void staticEvalBatch(std::span<const Position> positions, std::span<Score> evals, u32 threads) {
+        assert(evals.size() == positions.size());
+
+        if (positions.empty()) {
+            return;
+        }
+
+        std::vector<u32> keys(positions.size());
+        std::ranges::transform(positions, keys.begin(), groupKey);
+
+        std::vector<u32> order(positions.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        // stable, so positions within a group keep the caller's order, which
+        // usually already puts similar positions (e.g. from one game) together
+        std::ranges::stable_sort(order, {}, [&](u32 idx) { return keys[idx]; });
+
+        threads = std::clamp<u32>(threads, 1, static_cast<u32>(positions.size()));
+
+        if (threads == 1) {
+            evalSlice(positions, order, evals);
+            return;
+        }
+
+        // contiguous slices of the sorted order, so that groups are only split at slice boundaries.
+        // each thread writes to a disjoint set of indices
+        const auto sliceSize = (order.size() + threads - 1) / threads;
+
+        std::vector<std::thread> workers{};
+        workers.reserve(threads);
+
+        for (usize begin = 0; begin < order.size(); begin += sliceSize) {
+            const auto slice = std::span{order}.subspan(begin, std::min(sliceSize, order.size() - begin));
+            workers.emplace_back([positions, slice, evals] { evalSlice(positions, slice, evals); });
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    std::vector<Score> staticEvalBatch(std::span<const Position> positions, u32 threads) {
+        std::vector<Score> evals(positions.size());
+        staticEvalBatch(positions, evals, threads);
+        return evals;
+    }
+} // namespace stormphrax::eval
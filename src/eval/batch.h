@@ -0,0 +1,39 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+#include <vector>
+
+#include "../core.h"
+#include "../position/position.h"
+
+namespace stormphrax::eval {
+    // Static evals of many independent positions, identical to staticEvalOnce's, for
+    // offline jobs such as data filtering. Positions are evaluated grouped by the refresh
+    // table entries of both kings and then by output bucket, so that within a group each
+    // position only applies the feature transformer rows that differ from the previous
+    // one, and the output bucket's layer weights stay in cache. Groups are split across
+    // the given number of threads. evals must be as long as positions
+    void staticEvalBatch(std::span<const Position> positions, std::span<Score> evals, u32 threads = 1);
+
+    [[nodiscard]] std::vector<Score> staticEvalBatch(std::span<const Position> positions, u32 threads = 1);
+} // namespace stormphrax::eval
@@ -0,0 +1,78 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+
+namespace stormphrax::eval {
+    // Per-thread direct-mapped cache of raw network outputs, keyed by the full
+    // position key. Small enough to stay in L2. Entries are only valid for the
+    // network they were computed with, see syncNetwork
+    class EvalCache {
+    public:
+        // 128 KiB
+        static constexpr usize kEntries = 8192;
+
+        [[nodiscard]] inline bool probe(u64 key, i32& dst) const {
+            const auto& entry = m_entries[index(key)];
+
+            if (entry.key != key) {
+                return false;
+            }
+
+            dst = entry.eval;
+            return true;
+        }
+
+        inline void put(u64 key, i32 eval) {
+            m_entries[index(key)] = {key, eval};
+        }
+
+        inline void clear() {
+            m_entries.fill({});
+        }
+
+        // Clears the cache if the network has been (re)loaded since it was last
+        // synced, given eval::networkGeneration(). Called at the start of each search
+        inline void syncNetwork(u32 generation) {
+            if (generation != m_networkGeneration) {
+                clear();
+                m_networkGeneration = generation;
+            }
+        }
+
+    private:
+        struct Entry {
+            u64 key;
+            i32 eval;
+        };
+
+        static_assert(sizeof(Entry) == 16);
+
+        [[nodiscard]] static inline usize index(u64 key) {
+            return key % kEntries;
+        }
+
+        std::array<Entry, kEntries> m_entries{};
+
+        u32 m_networkGeneration{};
+    };
+} // namespace stormphrax::eval
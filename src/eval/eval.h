@@ -27,6 +27,7 @@
 #include "../position/position.h"
 #include "../see.h"
 #include "../tunable.h"
+#include "cache.h"
 #include "nnue.h"
 
 namespace stormphrax::eval {
@@ -82,6 +83,24 @@ namespace stormphrax::eval {
         return adjustStatic<kScale>(pos, contempt, eval);
     }
 
+    // Checks the cache before running the network
+    template <bool kScale = true>
+    inline Score staticEval(
+        const Position& pos,
+        NnueState& nnueState,
+        EvalCache& cache,
+        const Contempt& contempt = {}
+    ) {
+        i32 eval;
+
+        if (!cache.probe(pos.key(), eval)) {
+            eval = nnueState.evaluate(pos.bbs(), pos.kings(), pos.stm());
+            cache.put(pos.key(), eval);
+        }
+
+        return adjustStatic<kScale>(pos, contempt, eval);
+    }
+
     template <bool kCorrect = true>
     inline Score adjustedStaticEval(
         const Position& pos,
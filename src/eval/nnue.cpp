@@ -18,10 +18,18 @@
 
 #include "nnue.h"
 
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <type_traits>
 
+#include "../util/large_pages.h"
+#include "../util/mapped_file.h"
 #include "../util/memstream.h"
+#include "../util/shared_memory.h"
 #include "nnue/io_impl.h"
 
 #ifdef _MSC_VER
@@ -199,10 +207,194 @@ namespace stormphrax::eval {
             return success;
         }
 
+        constexpr std::array kCacheMagic{'S', 'P', 'N', 'C'};
+        constexpr u16 kCacheVersion = 1;
+
+        struct NetworkCacheHeader {
+            std::array<char, 4> magic{};
+            u16 version{};
+            u8 nameLen{};
+            [[maybe_unused]] u8 padding{};
+            u64 layoutHash{};
+            u64 networkHash{};
+            std::array<char, 40> name{};
+        };
+
+        // the network follows the header, and must stay aligned for SIMD loads
+        static_assert(sizeof(NetworkCacheHeader) == 64);
+        static_assert(sizeof(NetworkCacheHeader) % alignof(Network) == 0);
+
+        static_assert(std::is_trivially_copyable_v<Network>);
+
+        // everything the in-memory layout of the network depends on. a cache
+        // is only valid for builds that agree on all of these
+        consteval u64 networkLayoutHash() {
+            u64 hash = 0xcbf29ce484222325;
+
+            const auto mix = [&](u64 v) {
+                hash = (hash ^ v) * 0x100000001b3;
+            };
+
+            mix(sizeof(Network));
+            mix(alignof(Network));
+            mix(LayeredArch::kArchId);
+            mix(L1Activation::kId);
+            mix(kL1Size);
+            mix(InputFeatureSet::kBucketCount);
+            mix(OutputBucketing::kBucketCount);
+            mix(LayeredArch::kRequiresFtPermute);
+            mix(util::simd::kPackGrouping);
+
+            for (const auto idx : util::simd::kPackOrdering) {
+                mix(static_cast<u64>(idx));
+            }
+
+            return hash;
+        }
+
         Network s_network{};
+
+        // backs g_network when a network cache is loaded
+        std::unique_ptr<util::MappedFile> s_networkFile{};
+        // backs g_network when the network is shared between processes
+        std::unique_ptr<util::SharedMemory> s_networkSegment{};
+
+        bool s_shareNetwork{};
+
+        bool s_networkLoaded{};
+        std::string s_networkName{};
+
+        std::optional<u64> s_networkHash{};
+        u32 s_networkGeneration{};
+
+        // even a failed load may have overwritten some parameters
+        void invalidateNetworkState() {
+            s_networkHash.reset();
+            ++s_networkGeneration;
+        }
     } // namespace
 
-    const Network& g_network = s_network;
+    const Network* g_network = &s_network;
+
+    namespace {
+        // the owned copy is about to be overwritten, so stop using any mapped cache or segment
+        void useOwnedNetwork() {
+            g_network = &s_network;
+
+            s_networkFile.reset();
+            s_networkSegment.reset();
+        }
+
+        // Moves the loaded network into a shared memory segment named after its hash,
+        // or maps the segment if another process already did. Either way, this process
+        // stops holding a private copy
+        bool shareLoadedNetwork() {
+            if (s_networkSegment) {
+                return true;
+            }
+
+            const auto name = fmt::format("stormphrax-net-{:016x}-{:016x}", networkLayoutHash(), networkHash());
+
+            auto segment = std::make_unique<util::SharedMemory>();
+
+            const auto init = [](std::span<std::byte> dst) {
+                std::memcpy(dst.data(), g_network, sizeof(Network));
+                return true;
+            };
+
+            if (!segment->openOrCreate(name, sizeof(Network), init)) {
+                eprintln("failed to share network, keeping a private copy");
+                return false;
+            }
+
+            const bool usedOwned = g_network == &s_network;
+
+            g_network = reinterpret_cast<const Network*>(segment->data().data());
+
+            s_networkFile.reset();
+            s_networkSegment = std::move(segment);
+
+            if (usedOwned) {
+                util::discardPages(&s_network, sizeof(Network));
+            }
+
+            println(
+                "info string {} shared network segment {}",
+                s_networkSegment->created() ? "created" : "mapped",
+                name
+            );
+
+            return true;
+        }
+
+        // called after every successful load
+        void onNetworkLoaded() {
+            s_networkLoaded = true;
+
+            if (s_shareNetwork) {
+                shareLoadedNetwork();
+            }
+        }
+
+        bool loadNetworkCache(const std::string& path) {
+            auto file = std::make_unique<util::MappedFile>();
+
+            if (!file->open(path)) {
+                eprintln("failed to open network cache \"{}\"", path);
+                return false;
+            }
+
+            const auto data = file->data();
+
+            if (data.size() != sizeof(NetworkCacheHeader) + sizeof(Network)) {
+                eprintln(
+                    "wrong network cache size {} (expected: {})",
+                    data.size(),
+                    sizeof(NetworkCacheHeader) + sizeof(Network)
+                );
+                return false;
+            }
+
+            NetworkCacheHeader header{};
+            std::memcpy(&header, data.data(), sizeof(NetworkCacheHeader));
+
+            if (header.magic != kCacheMagic || header.version != kCacheVersion) {
+                eprintln("invalid network cache header");
+                return false;
+            }
+
+            if (header.layoutHash != networkLayoutHash()) {
+                eprintln("network cache was created for a different architecture or build, recreate it");
+                return false;
+            }
+
+            const auto* params = data.data() + sizeof(NetworkCacheHeader);
+
+            invalidateNetworkState();
+
+            // mmap()'d files are page aligned, read ones may not be
+            if (util::isAligned<alignof(Network)>(params)) {
+                g_network = reinterpret_cast<const Network*>(params);
+
+                s_networkFile = std::move(file);
+                s_networkSegment.reset();
+            } else {
+                useOwnedNetwork();
+                std::memcpy(&s_network, params, sizeof(Network));
+            }
+
+            s_networkHash = header.networkHash;
+
+            const std::string_view netName{header.name.data(), std::min<usize>(header.nameLen, header.name.size())};
+            s_networkName = netName;
+
+            println("info string loaded network cache of {}", netName);
+
+            onNetworkLoaded();
+
+            return true;
+        }
+    } // namespace
 
     void loadDefaultNetwork() {
         if (g_defaultNetSize < sizeof(NetworkHeader)) {
@@ -222,18 +414,33 @@ namespace stormphrax::eval {
 
         util::MemoryIstream stream{{begin, end}};
 
-        if (!loadNetworkFrom(s_network, stream, header)) {
+        useOwnedNetwork();
+
+        const bool loaded = loadNetworkFrom(s_network, stream, header);
+        invalidateNetworkState();
+
+        if (!loaded) {
             eprintln("Failed to load default network");
             return;
         }
+
+        s_networkName = defaultNetworkName();
+
+        onNetworkLoaded();
     }
 
-    void loadNetwork(std::string_view name) {
+    void ensureNetworkLoaded() {
+        if (!s_networkLoaded) {
+            loadDefaultNetwork();
+        }
+    }
+
+    bool loadNetwork(std::string_view name) {
         std::ifstream stream{std::string{name}, std::ios::binary};
 
         if (!stream) {
             eprintln("failed to open network file \"{}\"", name);
-            return;
+            return false;
         }
 
         NetworkHeader header{};
@@ -241,24 +448,116 @@ namespace stormphrax::eval {
 
         if (!stream) {
             eprintln("failed to read network file header");
-            return;
+            return false;
+        }
+
+        if (header.magic == kCacheMagic) {
+            stream.close();
+            return loadNetworkCache(std::string{name});
         }
 
         if (!validate(header)) {
-            return;
+            return false;
         }
 
-        if (!loadNetworkFrom(s_network, stream, header)) {
+        useOwnedNetwork();
+
+        const bool loaded = loadNetworkFrom(s_network, stream, header);
+        invalidateNetworkState();
+
+        if (!loaded) {
             eprintln("failed to read network parameters");
-            return;
+            return false;
         }
 
         const std::string_view netName{header.name.data(), header.nameLen};
+
+        s_networkName = netName;
+
         println("info string loaded network {}", netName);
+
+        onNetworkLoaded();
+
+        return true;
+    }
+
+    void setNetworkSharing(bool enabled) {
+        if (enabled == s_shareNetwork) {
+            return;
+        }
+
+        s_shareNetwork = enabled;
+
+        if (!s_networkLoaded) {
+            return;
+        }
+
+        if (enabled) {
+            shareLoadedNetwork();
+        } else if (s_networkSegment) {
+            // the hash stays valid, as the parameters are unchanged
+            std::memcpy(&s_network, g_network, sizeof(Network));
+            g_network = &s_network;
+            s_networkSegment.reset();
+        }
+    }
+
+    bool writeNetworkCache(std::string_view path) {
+        std::ofstream stream{std::string{path}, std::ios::binary};
+
+        if (!stream) {
+            eprintln("failed to open \"{}\" for writing", path);
+            return false;
+        }
+
+        NetworkCacheHeader header{};
+
+        header.magic = kCacheMagic;
+        header.version = kCacheVersion;
+        header.layoutHash = networkLayoutHash();
+        header.networkHash = networkHash();
+
+        header.nameLen = static_cast<u8>(std::min(s_networkName.size(), header.name.size()));
+        std::ranges::copy(s_networkName.substr(0, header.nameLen), header.name.begin());
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(g_network), sizeof(Network));
+
+        if (!stream) {
+            eprintln("failed to write network cache");
+            return false;
+        }
+
+        println("info string wrote network cache to {}", path);
+        return true;
     }
 
     std::string_view defaultNetworkName() {
         const auto& header = *reinterpret_cast<const NetworkHeader*>(g_defaultNetData);
         return {header.name.data(), header.nameLen};
     }
+
+    u32 networkGeneration() {
+        return s_networkGeneration;
+    }
+
+    u64 networkHash() {
+        if (s_networkHash) {
+            return *s_networkHash;
+        }
+
+        static_assert(sizeof(Network) % sizeof(u64) == 0);
+
+        const auto* words = reinterpret_cast<const u64*>(g_network);
+
+        u64 hash = 0xcbf29ce484222325;
+
+        for (usize i = 0; i < sizeof(Network) / sizeof(u64); ++i) {
+            hash = (hash ^ words[i]) * 0x9e3779b97f4a7c15;
+            hash ^= hash >> 29;
+        }
+
+        s_networkHash = hash;
+        return hash;
+    }
 } // namespace stormphrax::eval
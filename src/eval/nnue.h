@@ -22,6 +22,7 @@
 
 #include <vector>
 
+#include "../profiler.h"
 #include "../util/static_vector.h"
 #include "arch.h"
 #include "nnue/activation.h"
@@ -36,13 +37,33 @@ namespace stormphrax::eval {
     using Accumulator = FeatureTransformer::Accumulator;
     using RefreshTable = FeatureTransformer::RefreshTable;
 
-    extern const Network& g_network;
+    // points either at an owned copy, or straight into a mapped network cache
+    extern const Network* g_network;
 
     void loadDefaultNetwork();
-    void loadNetwork(std::string_view name);
+    // loads the embedded network, unless a network has already been loaded
+    void ensureNetworkLoaded();
+    // accepts network files and network caches. On failure, the previously
+    // loaded network may have been partially overwritten
+    bool loadNetwork(std::string_view name);
+
+    // When enabled, the loaded network (and any network loaded later) is placed in a
+    // shared memory segment keyed by its hash, so that engine processes on the same
+    // host map a single copy of it. Disabling it switches back to a private copy
+    void setNetworkSharing(bool enabled);
+
+    // Writes the loaded network in its final in-memory layout, which is specific to this
+    // build's SIMD target, so that it can be mapped and used in place without any copying
+    bool writeNetworkCache(std::string_view path);
 
     [[nodiscard]] std::string_view defaultNetworkName();
 
+    // Hash of the loaded network's parameters, computed on first use
+    [[nodiscard]] u64 networkHash();
+
+    // Incremented whenever the network is (re)loaded
+    [[nodiscard]] u32 networkGeneration();
+
     struct NnueUpdates {
         using PieceSquare = std::pair<Piece, Square>;
 
@@ -110,20 +131,17 @@ namespace stormphrax::eval {
         inline void reset(const BitboardSet& bbs, KingPair kings) {
             assert(kings.isValid());
 
-            m_refreshTable.init(g_network.featureTransformer());
+            // refresh table entries always match their stored boards, so
+            // they stay valid across searches until the network changes
+            if (const auto generation = networkGeneration(); generation != m_networkGeneration) {
+                m_refreshTable.init(g_network->featureTransformer());
+                m_networkGeneration = generation;
+            }
 
             m_curr = &m_accumulatorStack[0];
 
-            for (const auto c : {Color::kBlack, Color::kWhite}) {
-                const auto king = kings.color(c);
-                const auto entry = InputFeatureSet::getRefreshTableEntry(c, king);
-
-                auto& rtEntry = m_refreshTable.table[entry];
-                resetAccumulator(rtEntry.accumulator, c, bbs, king);
-
-                m_curr->acc.copyFrom(c, rtEntry.accumulator);
-                rtEntry.colorBbs(c) = bbs;
-            }
+            refreshAccumulator(*m_curr, Color::kBlack, bbs, m_refreshTable, kings.black());
+            refreshAccumulator(*m_curr, Color::kWhite, bbs, m_refreshTable, kings.white());
         }
 
         template <bool ApplyImmediately>
@@ -158,20 +176,76 @@ namespace stormphrax::eval {
             assert(stm != Color::kNone);
 
             Accumulator accumulator{};
+            initAccumulator(accumulator, bbs, kings);
+
+            return evaluate(accumulator, bbs, stm);
+        }
 
-            accumulator.initBoth(g_network.featureTransformer());
+        // Evaluates a standalone position through a caller-owned refresh table. Only the features
+        // that differ from the last position refreshed through the same entries are applied, so
+        // runs of positions that share king buckets are much cheaper than evaluateOnce
+        [[nodiscard]] static inline i32 evaluateWithTable(
+            const BitboardSet& bbs,
+            KingPair kings,
+            Color stm,
+            RefreshTable& refreshTable
+        ) {
+            assert(kings.isValid());
+            assert(stm != Color::kNone);
+
+            UpdatableAccumulator accumulator{};
+
+            refreshAccumulator(accumulator, Color::kBlack, bbs, refreshTable, kings.black());
+            refreshAccumulator(accumulator, Color::kWhite, bbs, refreshTable, kings.white());
+
+            return evaluate(accumulator.acc, bbs, stm);
+        }
+
+        // builds both perspectives from scratch, without going through a refresh table
+        static inline void initAccumulator(Accumulator& accumulator, const BitboardSet& bbs, KingPair kings) {
+            accumulator.initBoth(g_network->featureTransformer());
 
             resetAccumulator(accumulator, Color::kBlack, bbs, kings.black());
             resetAccumulator(accumulator, Color::kWhite, bbs, kings.white());
+        }
 
-            return evaluate(accumulator, bbs, stm);
+        [[nodiscard]] static inline u32 featureIndex(Color c, Piece piece, Square sq, Square king) {
+            assert(c != Color::kNone);
+            assert(piece != Piece::kNone);
+            assert(sq != Square::kNone);
+            assert(king != Square::kNone);
+
+            constexpr u32 kColorStride = 64 * 6;
+            constexpr u32 kPieceStride = 64;
+
+            const auto type = static_cast<u32>(pieceType(piece));
+
+            const auto color = [piece, c]() -> u32 {
+                if (InputFeatureSet::kMergedKings && pieceType(piece) == PieceType::kKing) {
+                    return 0;
+                }
+                return pieceColor(piece) == c ? 0 : 1;
+            }();
+
+            if (c == Color::kBlack) {
+                sq = flipSquareRank(sq);
+            }
+
+            sq = InputFeatureSet::transformFeatureSquare(sq, king);
+
+            const auto bucketOffset = InputFeatureSet::getBucket(c, king) * InputFeatureSet::kInputSize;
+            return bucketOffset + color * kColorStride + type * kPieceStride + static_cast<u32>(sq);
         }
 
     private:
+        static constexpr i32 kMaxFusedPlies = 16;
+
         std::vector<UpdatableAccumulator> m_accumulatorStack{};
         UpdatableAccumulator* m_curr{};
 
         RefreshTable m_refreshTable{};
+        // network generation m_refreshTable was initialised with, 0 if never
+        u32 m_networkGeneration{};
 
         static inline void update(
             const Accumulator& prev,
@@ -202,7 +276,7 @@ namespace stormphrax::eval {
                 const auto sub = featureIndex(c, subPiece, subSquare, king);
                 const auto add = featureIndex(c, addPiece, addSquare, king);
 
-                curr.acc.subAddFrom(prev, g_network.featureTransformer(), c, sub, add);
+                curr.acc.subAddFrom(prev, g_network->featureTransformer(), c, sub, add);
             } else if (addCount == 1 && subCount == 2) // any capture
             {
                 const auto [subPiece0, subSquare0] = ctx.updates.sub[0];
@@ -213,7 +287,7 @@ namespace stormphrax::eval {
                 const auto sub1 = featureIndex(c, subPiece1, subSquare1, king);
                 const auto add = featureIndex(c, addPiece, addSquare, king);
 
-                curr.acc.subSubAddFrom(prev, g_network.featureTransformer(), c, sub0, sub1, add);
+                curr.acc.subSubAddFrom(prev, g_network->featureTransformer(), c, sub0, sub1, add);
             } else if (addCount == 2 && subCount == 2) // castling
             {
                 const auto [subPiece0, subSquare0] = ctx.updates.sub[0];
@@ -226,7 +300,7 @@ namespace stormphrax::eval {
                 const auto add0 = featureIndex(c, addPiece0, addSquare0, king);
                 const auto add1 = featureIndex(c, addPiece1, addSquare1, king);
 
-                curr.acc.subSubAddAddFrom(prev, g_network.featureTransformer(), c, sub0, sub1, add0, add1);
+                curr.acc.subSubAddAddFrom(prev, g_network->featureTransformer(), c, sub0, sub1, add0, add1);
             } else {
                 assert(false && "Materialising a piece from nowhere?");
             }
@@ -234,17 +308,127 @@ namespace stormphrax::eval {
             curr.setUpdated(c);
         }
 
+        // applies the net feature changes of every accumulator after base up to and including
+        // target to target, without touching the ones in between. none may require a refresh,
+        // so the king bucket is the same throughout and features cancel exactly
+        static inline void fusedUpdate(const UpdatableAccumulator& base, UpdatableAccumulator& target, Color c) {
+            assert(&target - &base <= kMaxFusedPlies);
+
+            StaticVector<u32, kMaxFusedPlies * 2> adds{};
+            StaticVector<u32, kMaxFusedPlies * 2> subs{};
+
+            // a feature added then removed again (or the reverse) cancels out
+            const auto push = [](auto& dst, auto& opposite, u32 feature) {
+                for (usize i = 0; i < opposite.size(); ++i) {
+                    if (opposite[i] == feature) {
+                        opposite[i] = opposite[opposite.size() - 1];
+                        opposite.pop();
+                        return;
+                    }
+                }
+
+                dst.push(feature);
+            };
+
+            for (const auto* curr = &base + 1; curr <= &target; ++curr) {
+                assert(!curr->ctx.updates.requiresRefresh(c));
+
+                const auto king = curr->ctx.kings.color(c);
+
+                for (const auto [piece, square] : curr->ctx.updates.sub) {
+                    push(subs, adds, featureIndex(c, piece, square, king));
+                }
+
+                for (const auto [piece, square] : curr->ctx.updates.add) {
+                    push(adds, subs, featureIndex(c, piece, square, king));
+                }
+            }
+
+            target.acc.updateFrom(
+                base.acc,
+                g_network->featureTransformer(),
+                c,
+                {adds.begin(), adds.end()},
+                {subs.begin(), subs.end()}
+            );
+
+            target.setUpdated(c);
+        }
+
+        template <usize kAdds, usize kSubs>
+        static inline void updateBothIncremental(
+            const Accumulator& prev,
+            UpdatableAccumulator& curr,
+            const UpdateContext& ctx
+        ) {
+            std::array<std::array<u32, kAdds>, 2> adds{};
+            std::array<std::array<u32, kSubs>, 2> subs{};
+
+            for (const auto c : {Color::kBlack, Color::kWhite}) {
+                const auto idx = static_cast<i32>(c);
+                const auto king = ctx.kings.color(c);
+
+                for (usize i = 0; i < kAdds; ++i) {
+                    const auto [piece, square] = ctx.updates.add[i];
+                    adds[idx][i] = featureIndex(c, piece, square, king);
+                }
+
+                for (usize i = 0; i < kSubs; ++i) {
+                    const auto [piece, square] = ctx.updates.sub[i];
+                    subs[idx][i] = featureIndex(c, piece, square, king);
+                }
+            }
+
+            curr.acc.updateBothFrom(prev, g_network->featureTransformer(), adds, subs);
+
+            curr.setUpdated(Color::kBlack);
+            curr.setUpdated(Color::kWhite);
+        }
+
         static inline void updateBoth(
             const Accumulator& prev,
             UpdatableAccumulator& curr,
             RefreshTable& refreshTable,
             const UpdateContext& ctx
         ) {
+            // without a king bucket change both perspectives have the same
+            // number of changes, so they can be updated in a single pass
+            if (!ctx.updates.requiresRefresh(Color::kBlack) && !ctx.updates.requiresRefresh(Color::kWhite)) {
+                const auto subCount = ctx.updates.sub.size();
+                const auto addCount = ctx.updates.add.size();
+
+                if (addCount == 1 && subCount == 1) {
+                    updateBothIncremental<1, 1>(prev, curr, ctx);
+                    return;
+                } else if (addCount == 1 && subCount == 2) {
+                    updateBothIncremental<1, 2>(prev, curr, ctx);
+                    return;
+                } else if (addCount == 2 && subCount == 2) {
+                    updateBothIncremental<2, 2>(prev, curr, ctx);
+                    return;
+                }
+            }
+
             update(prev, curr, refreshTable, ctx, Color::kBlack);
             update(prev, curr, refreshTable, ctx, Color::kWhite);
         }
 
         inline void ensureUpToDate(const BitboardSet& bbs, KingPair kings) {
+            const profiler::ScopedTimer timer{profiler::Component::kNnueUpdate};
+
+            // the common case, a single non-refreshing move since the last evaluated position.
+            // refreshes are left to the loop below, as ctx holds the parent's boards and kings
+            if (m_curr->isDirty(Color::kBlack) && m_curr->isDirty(Color::kWhite)
+                && !m_curr->ctx.updates.requiresRefresh(Color::kBlack)
+                && !m_curr->ctx.updates.requiresRefresh(Color::kWhite))
+            {
+                auto& prev = *(m_curr - 1);
+
+                if (!prev.isDirty(Color::kBlack) && !prev.isDirty(Color::kWhite)) {
+                    updateBoth(prev.acc, *m_curr, m_refreshTable, m_curr->ctx);
+                }
+            }
+
             for (const auto c : {Color::kBlack, Color::kWhite}) {
                 if (!m_curr->isDirty(c)) {
                     continue;
@@ -268,21 +452,29 @@ namespace stormphrax::eval {
                 if (curr->ctx.updates.requiresRefresh(c)) {
                     refreshAccumulator(*m_curr, c, bbs, m_refreshTable, kings.color(c));
                 } else {
-                    // otherwise go forward and incrementally update all accumulators in between
-                    do {
+                    // otherwise go forward and incrementally update the current accumulator. the
+                    // changes of up to kMaxFusedPlies plies are applied in one pass, skipping the
+                    // accumulators in between. they stay dirty, and are caught up if ever needed
+                    while (m_curr - curr > kMaxFusedPlies) {
                         const auto& prev = *curr;
 
                         ++curr;
                         update(prev.acc, *curr, m_refreshTable, curr->ctx, c);
-                    } while (curr != m_curr);
+                    }
+
+                    if (m_curr - curr == 1) {
+                        update(curr->acc, *m_curr, m_refreshTable, m_curr->ctx, c);
+                    } else {
+                        fusedUpdate(*curr, *m_curr, c);
+                    }
                 }
             }
         }
 
         [[nodiscard]] static inline i32 evaluate(const Accumulator& accumulator, const BitboardSet& bbs, Color stm) {
             assert(stm != Color::kNone);
-            return stm == Color::kBlack ? g_network.propagate(bbs, accumulator.black(), accumulator.white())[0]
-                                        : g_network.propagate(bbs, accumulator.white(), accumulator.black())[0];
+            return stm == Color::kBlack ? g_network->propagate(bbs, accumulator.black(), accumulator.white())[0]
+                                        : g_network->propagate(bbs, accumulator.white(), accumulator.black())[0];
         }
 
         static inline void refreshAccumulator(
@@ -321,33 +513,14 @@ namespace stormphrax::eval {
                 }
             }
 
-            while (adds.size() >= 4) {
-                const auto add0 = adds.pop();
-                const auto add1 = adds.pop();
-                const auto add2 = adds.pop();
-                const auto add3 = adds.pop();
-                rtEntry.accumulator.activateFourFeatures(g_network.featureTransformer(), c, add0, add1, add2, add3);
-            }
-
-            while (adds.size() >= 1) {
-                const auto add = adds.pop();
-                rtEntry.accumulator.activateFeature(g_network.featureTransformer(), c, add);
-            }
-
-            while (subs.size() >= 4) {
-                const auto sub0 = subs.pop();
-                const auto sub1 = subs.pop();
-                const auto sub2 = subs.pop();
-                const auto sub3 = subs.pop();
-                rtEntry.accumulator.deactivateFourFeatures(g_network.featureTransformer(), c, sub0, sub1, sub2, sub3);
-            }
+            rtEntry.accumulator.applyAndCopyTo(
+                g_network->featureTransformer(),
+                c,
+                {adds.begin(), adds.end()},
+                {subs.begin(), subs.end()},
+                accumulator.acc
+            );
 
-            while (subs.size() >= 1) {
-                const auto sub = subs.pop();
-                rtEntry.accumulator.deactivateFeature(g_network.featureTransformer(), c, sub);
-            }
-
-            accumulator.acc.copyFrom(c, rtEntry.accumulator);
             prevBoards = bbs;
 
             accumulator.setUpdated(c);
@@ -367,7 +540,7 @@ namespace stormphrax::eval {
                     const auto sq = board.popLowestSquare();
 
                     const auto feature = featureIndex(c, piece, sq, king);
-                    accumulator.activateFeature(g_network.featureTransformer(), c, feature);
+                    accumulator.activateFeature(g_network->featureTransformer(), c, feature);
                 }
             }
         }
@@ -381,33 +554,5 @@ namespace stormphrax::eval {
             resetAccumulator(accumulator.acc, c, bbs, king);
             accumulator.setUpdated(c);
         }
-
-        [[nodiscard]] static inline u32 featureIndex(Color c, Piece piece, Square sq, Square king) {
-            assert(c != Color::kNone);
-            assert(piece != Piece::kNone);
-            assert(sq != Square::kNone);
-            assert(king != Square::kNone);
-
-            constexpr u32 kColorStride = 64 * 6;
-            constexpr u32 kPieceStride = 64;
-
-            const auto type = static_cast<u32>(pieceType(piece));
-
-            const auto color = [piece, c]() -> u32 {
-                if (InputFeatureSet::kMergedKings && pieceType(piece) == PieceType::kKing) {
-                    return 0;
-                }
-                return pieceColor(piece) == c ? 0 : 1;
-            }();
-
-            if (c == Color::kBlack) {
-                sq = flipSquareRank(sq);
-            }
-
-            sq = InputFeatureSet::transformFeatureSquare(sq, king);
-
-            const auto bucketOffset = InputFeatureSet::getBucket(c, king) * InputFeatureSet::kInputSize;
-            return bucketOffset + color * kColorStride + type * kPieceStride + static_cast<u32>(sq);
-        }
     };
 } // namespace stormphrax::eval
@@ -79,7 +79,14 @@ namespace stormphrax::eval::nnue {
             assert(sub < kInputCount);
             assert(add < kInputCount);
 
-            subAdd(src.forColor(c), forColor(c), featureTransformer.weights, sub * kOutputCount, add * kOutputCount);
+            const auto idx = static_cast<i32>(c);
+            updateTiled<1, 1, 1>(
+                {src.m_outputs[idx].data()},
+                {m_outputs[idx].data()},
+                featureTransformer.weights.data(),
+                {{{add * kOutputCount}}},
+                {{{sub * kOutputCount}}}
+            );
         }
 
         inline void subSubAddFrom(
@@ -94,13 +101,13 @@ namespace stormphrax::eval::nnue {
             assert(sub1 < kInputCount);
             assert(add < kInputCount);
 
-            subSubAdd(
-                src.forColor(c),
-                forColor(c),
-                featureTransformer.weights,
-                sub0 * kOutputCount,
-                sub1 * kOutputCount,
-                add * kOutputCount
+            const auto idx = static_cast<i32>(c);
+            updateTiled<1, 1, 2>(
+                {src.m_outputs[idx].data()},
+                {m_outputs[idx].data()},
+                featureTransformer.weights.data(),
+                {{{add * kOutputCount}}},
+                {{{sub0 * kOutputCount, sub1 * kOutputCount}}}
             );
         }
 
@@ -118,68 +125,109 @@ namespace stormphrax::eval::nnue {
             assert(add0 < kInputCount);
             assert(add1 < kInputCount);
 
-            subSubAddAdd(
-                src.forColor(c),
-                forColor(c),
-                featureTransformer.weights,
-                sub0 * kOutputCount,
-                sub1 * kOutputCount,
-                add0 * kOutputCount,
-                add1 * kOutputCount
+            const auto idx = static_cast<i32>(c);
+            updateTiled<1, 2, 2>(
+                {src.m_outputs[idx].data()},
+                {m_outputs[idx].data()},
+                featureTransformer.weights.data(),
+                {{{add0 * kOutputCount, add1 * kOutputCount}}},
+                {{{sub0 * kOutputCount, sub1 * kOutputCount}}}
             );
         }
 
-        inline void activateFeature(const Ft& featureTransformer, Color c, u32 feature) {
-            assert(feature < kInputCount);
-            add(forColor(c), featureTransformer.weights, feature * kOutputCount);
-        }
+        // both perspectives in one pass, features are indexed [black, white]
+        template <usize kAdds, usize kSubs>
+        inline void updateBothFrom(
+            const Accumulator<Ft>& src,
+            const Ft& featureTransformer,
+            const std::array<std::array<u32, kAdds>, 2>& adds,
+            const std::array<std::array<u32, kSubs>, 2>& subs
+        ) {
+            std::array<std::array<u32, kAdds>, 2> addOffsets{};
+            std::array<std::array<u32, kSubs>, 2> subOffsets{};
+
+            for (usize perspective = 0; perspective < 2; ++perspective) {
+                for (usize i = 0; i < kAdds; ++i) {
+                    assert(adds[perspective][i] < kInputCount);
+                    addOffsets[perspective][i] = adds[perspective][i] * kOutputCount;
+                }
+
+                for (usize i = 0; i < kSubs; ++i) {
+                    assert(subs[perspective][i] < kInputCount);
+                    subOffsets[perspective][i] = subs[perspective][i] * kOutputCount;
+                }
+            }
 
-        inline void deactivateFeature(const Ft& featureTransformer, Color c, u32 feature) {
-            assert(feature < kInputCount);
-            sub(forColor(c), featureTransformer.weights, feature * kOutputCount);
+            updateTiled<2, kAdds, kSubs>(
+                {src.m_outputs[0].data(), src.m_outputs[1].data()},
+                {m_outputs[0].data(), m_outputs[1].data()},
+                featureTransformer.weights.data(),
+                addOffsets,
+                subOffsets
+            );
         }
 
-        inline void activateFourFeatures(
+        // applies any number of feature changes to one perspective of src in a single pass
+        inline void updateFrom(
+            const Accumulator<Ft>& src,
             const Ft& featureTransformer,
             Color c,
-            u32 feature0,
-            u32 feature1,
-            u32 feature2,
-            u32 feature3
+            std::span<const u32> adds,
+            std::span<const u32> subs
         ) {
-            assert(feature0 < kInputCount);
-            assert(feature1 < kInputCount);
-            assert(feature2 < kInputCount);
-            assert(feature3 < kInputCount);
-            addAddAddAdd(
-                forColor(c),
-                featureTransformer.weights,
-                feature0 * kOutputCount,
-                feature1 * kOutputCount,
-                feature2 * kOutputCount,
-                feature3 * kOutputCount
+            const auto idx = static_cast<i32>(c);
+            updateTiledDynamic(
+                src.m_outputs[idx].data(),
+                m_outputs[idx].data(),
+                nullptr,
+                featureTransformer.weights.data(),
+                adds,
+                subs
             );
         }
 
-        inline void deactivateFourFeatures(
+        // as updateFrom, in place, and writes the result to the same perspective of copyDst as well
+        inline void applyAndCopyTo(
             const Ft& featureTransformer,
             Color c,
-            u32 feature0,
-            u32 feature1,
-            u32 feature2,
-            u32 feature3
+            std::span<const u32> adds,
+            std::span<const u32> subs,
+            Accumulator<Ft>& copyDst
         ) {
-            assert(feature0 < kInputCount);
-            assert(feature1 < kInputCount);
-            assert(feature2 < kInputCount);
-            assert(feature3 < kInputCount);
-            subSubSubSub(
-                forColor(c),
-                featureTransformer.weights,
-                feature0 * kOutputCount,
-                feature1 * kOutputCount,
-                feature2 * kOutputCount,
-                feature3 * kOutputCount
+            const auto idx = static_cast<i32>(c);
+            updateTiledDynamic(
+                m_outputs[idx].data(),
+                m_outputs[idx].data(),
+                copyDst.m_outputs[idx].data(),
+                featureTransformer.weights.data(),
+                adds,
+                subs
+            );
+        }
+
+        inline void activateFeature(const Ft& featureTransformer, Color c, u32 feature) {
+            assert(feature < kInputCount);
+
+            const auto idx = static_cast<i32>(c);
+            updateTiled<1, 1, 0>(
+                {m_outputs[idx].data()},
+                {m_outputs[idx].data()},
+                featureTransformer.weights.data(),
+                {{{feature * kOutputCount}}},
+                {}
+            );
+        }
+
+        inline void deactivateFeature(const Ft& featureTransformer, Color c, u32 feature) {
+            assert(feature < kInputCount);
+
+            const auto idx = static_cast<i32>(c);
+            updateTiled<1, 0, 1>(
+                {m_outputs[idx].data()},
+                {m_outputs[idx].data()},
+                featureTransformer.weights.data(),
+                {},
+                {{{feature * kOutputCount}}}
             );
         }
 
@@ -189,119 +237,118 @@ namespace stormphrax::eval::nnue {
         }
 
     private:
-        SP_SIMD_ALIGNAS util::MultiArray<Type, 2, kOutputCount> m_outputs;
+        static constexpr u32 kChunkSize = util::simd::kChunkSize<Type>;
+        static constexpr u32 kChunkCount = kOutputCount / kChunkSize;
 
-        static inline void subAdd(
-            std::span<const Type, kOutputCount> src,
-            std::span<Type, kOutputCount> dst,
-            std::span<const Type, kWeightCount> delta,
-            u32 subOffset,
-            u32 addOffset
-        ) {
-            assert(subOffset + kOutputCount <= delta.size());
-            assert(addOffset + kOutputCount <= delta.size());
-
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                dst[i] = src[i] + delta[addOffset + i] - delta[subOffset + i];
-            }
-        }
+        static_assert(kOutputCount % kChunkSize == 0);
 
-        static inline void subSubAdd(
-            std::span<const Type, kOutputCount> src,
-            std::span<Type, kOutputCount> dst,
-            std::span<const Type, kWeightCount> delta,
-            u32 subOffset0,
-            u32 subOffset1,
-            u32 addOffset
-        ) {
-            assert(subOffset0 + kOutputCount <= delta.size());
-            assert(subOffset1 + kOutputCount <= delta.size());
-            assert(addOffset + kOutputCount <= delta.size());
+        // largest tile that divides the accumulator evenly,
+        // leaving a couple of registers free for weights
+        static constexpr u32 kTileRegisters = [] {
+            auto regs = std::min<u32>(kChunkCount, util::simd::kRegisterCount - 2);
 
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                dst[i] = src[i] + delta[addOffset + i] - delta[subOffset0 + i] - delta[subOffset1 + i];
+            while (kChunkCount % regs != 0) {
+                --regs;
             }
-        }
 
-        static inline void subSubAddAdd(
-            std::span<const Type, kOutputCount> src,
-            std::span<Type, kOutputCount> dst,
-            std::span<const Type, kWeightCount> delta,
-            u32 subOffset0,
-            u32 subOffset1,
-            u32 addOffset0,
-            u32 addOffset1
-        ) {
-            assert(subOffset0 + kOutputCount <= delta.size());
-            assert(subOffset1 + kOutputCount <= delta.size());
-            assert(addOffset0 + kOutputCount <= delta.size());
-            assert(addOffset1 + kOutputCount <= delta.size());
-
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                dst[i] = src[i] + delta[addOffset0 + i] - delta[subOffset0 + i] + delta[addOffset1 + i]
-                       - delta[subOffset1 + i];
-            }
-        }
+            return regs;
+        }();
 
-        static __attribute__((always_inline)) inline void addAddAddAdd(
-            std::span<Type, kOutputCount> accumulator,
-            std::span<const Type, kWeightCount> delta,
-            u32 addOffset0,
-            u32 addOffset1,
-            u32 addOffset2,
-            u32 addOffset3
-        ) {
-            assert(addOffset0 + kOutputCount <= delta.size());
-            assert(addOffset1 + kOutputCount <= delta.size());
-            assert(addOffset2 + kOutputCount <= delta.size());
-            assert(addOffset3 + kOutputCount <= delta.size());
-
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                accumulator[i] +=
-                    delta[addOffset0 + i] + delta[addOffset1 + i] + delta[addOffset2 + i] + delta[addOffset3 + i];
-            }
-        }
+        static constexpr u32 kTileSize = kTileRegisters * kChunkSize;
 
-        static __attribute__((always_inline)) inline void subSubSubSub(
-            std::span<Type, kOutputCount> accumulator,
-            std::span<const Type, kWeightCount> delta,
-            u32 subOffset0,
-            u32 subOffset1,
-            u32 subOffset2,
-            u32 subOffset3
-        ) {
-            assert(subOffset0 + kOutputCount <= delta.size());
-            assert(subOffset1 + kOutputCount <= delta.size());
-            assert(subOffset2 + kOutputCount <= delta.size());
-            assert(subOffset3 + kOutputCount <= delta.size());
-
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                accumulator[i] -=
-                    delta[subOffset0 + i] + delta[subOffset1 + i] + delta[subOffset2 + i] + delta[subOffset3 + i];
-            }
-        }
+        SP_SIMD_ALIGNAS util::MultiArray<Type, 2, kOutputCount> m_outputs;
 
-        static inline void add(
-            std::span<Type, kOutputCount> accumulator,
-            std::span<const Type, kWeightCount> delta,
-            u32 offset
+        // Register tiled: each tile of each perspective is loaded from src once, has
+        // every weight row applied in registers, and is stored to dst once. src and dst
+        // may alias. i16 arithmetic wraps, so the order of the rows does not matter
+        template <usize kPerspectives, usize kAdds, usize kSubs>
+        static SP_ALWAYS_INLINE_NDEBUG inline void updateTiled(
+            const std::array<const Type*, kPerspectives>& src,
+            const std::array<Type*, kPerspectives>& dst,
+            const Type* weights,
+            const std::array<std::array<u32, kAdds>, kPerspectives>& addOffsets,
+            const std::array<std::array<u32, kSubs>, kPerspectives>& subOffsets
         ) {
-            assert(offset + kOutputCount <= delta.size());
-
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                accumulator[i] += delta[offset + i];
+            using namespace util::simd;
+
+            for (u32 tile = 0; tile < kOutputCount; tile += kTileSize) {
+                for (usize perspective = 0; perspective < kPerspectives; ++perspective) {
+                    std::array<Vector<Type>, kTileRegisters> regs;
+
+                    for (u32 i = 0; i < kTileRegisters; ++i) {
+                        regs[i] = load<Type>(&src[perspective][tile + i * kChunkSize]);
+                    }
+
+                    for (const auto offset : addOffsets[perspective]) {
+                        assert(offset + kOutputCount <= kWeightCount);
+                        const auto* row = &weights[offset + tile];
+
+                        for (u32 i = 0; i < kTileRegisters; ++i) {
+                            regs[i] = add<Type>(regs[i], load<Type>(&row[i * kChunkSize]));
+                        }
+                    }
+
+                    for (const auto offset : subOffsets[perspective]) {
+                        assert(offset + kOutputCount <= kWeightCount);
+                        const auto* row = &weights[offset + tile];
+
+                        for (u32 i = 0; i < kTileRegisters; ++i) {
+                            regs[i] = sub<Type>(regs[i], load<Type>(&row[i * kChunkSize]));
+                        }
+                    }
+
+                    for (u32 i = 0; i < kTileRegisters; ++i) {
+                        store<Type>(&dst[perspective][tile + i * kChunkSize], regs[i]);
+                    }
+                }
             }
         }
 
-        static inline void sub(
-            std::span<Type, kOutputCount> accumulator,
-            std::span<const Type, kWeightCount> delta,
-            u32 offset
+        // as updateTiled, for one perspective and a runtime number of rows. copyDst may be null
+        static inline void updateTiledDynamic(
+            const Type* src,
+            Type* dst,
+            Type* copyDst,
+            const Type* weights,
+            std::span<const u32> adds,
+            std::span<const u32> subs
         ) {
-            assert(offset + kOutputCount <= delta.size());
-
-            for (u32 i = 0; i < kOutputCount; ++i) {
-                accumulator[i] -= delta[offset + i];
+            using namespace util::simd;
+
+            for (u32 tile = 0; tile < kOutputCount; tile += kTileSize) {
+                std::array<Vector<Type>, kTileRegisters> regs;
+
+                for (u32 i = 0; i < kTileRegisters; ++i) {
+                    regs[i] = load<Type>(&src[tile + i * kChunkSize]);
+                }
+
+                for (const auto feature : adds) {
+                    assert(feature < kInputCount);
+                    const auto* row = &weights[feature * kOutputCount + tile];
+
+                    for (u32 i = 0; i < kTileRegisters; ++i) {
+                        regs[i] = add<Type>(regs[i], load<Type>(&row[i * kChunkSize]));
+                    }
+                }
+
+                for (const auto feature : subs) {
+                    assert(feature < kInputCount);
+                    const auto* row = &weights[feature * kOutputCount + tile];
+
+                    for (u32 i = 0; i < kTileRegisters; ++i) {
+                        regs[i] = sub<Type>(regs[i], load<Type>(&row[i * kChunkSize]));
+                    }
+                }
+
+                for (u32 i = 0; i < kTileRegisters; ++i) {
+                    store<Type>(&dst[tile + i * kChunkSize], regs[i]);
+                }
+
+                if (copyDst) {
+                    for (u32 i = 0; i < kTileRegisters; ++i) {
+                        store<Type>(&copyDst[tile + i * kChunkSize], regs[i]);
+                    }
+                }
             }
         }
     };
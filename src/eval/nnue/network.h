@@ -23,6 +23,7 @@
 #include <span>
 
 #include "../../position/boards.h"
+#include "../../profiler.h"
 #include "../../util/aligned_array.h"
 
 namespace stormphrax::eval::nnue {
@@ -40,6 +41,8 @@ namespace stormphrax::eval::nnue {
             std::span<const typename FeatureTransformer::OutputType, FeatureTransformer::kOutputCount> stmInputs,
             std::span<const typename FeatureTransformer::OutputType, FeatureTransformer::kOutputCount> nstmInputs
         ) const {
+            const profiler::ScopedTimer timer{profiler::Component::kNnuePropagate};
+
             util::simd::Array<typename Arch::OutputType, Arch::kOutputCount> outputs;
 
             const auto bucket = OutputBucketing::getBucket(bbs);
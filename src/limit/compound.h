@@ -20,7 +20,10 @@
 
 #include "../types.h"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "limit.h"
@@ -53,6 +56,28 @@ namespace stormphrax::limit {
             });
         }
 
+        [[nodiscard]] inline std::optional<util::Instant> hardDeadline() const final {
+            std::optional<util::Instant> result{};
+
+            for (const auto& limiter : m_limiters) {
+                if (const auto deadline = limiter->hardDeadline(); deadline && (!result || *deadline < *result)) {
+                    result = deadline;
+                }
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] inline usize hardNodeLimit() const final {
+            auto result = std::numeric_limits<usize>::max();
+
+            for (const auto& limiter : m_limiters) {
+                result = std::min(result, limiter->hardNodeLimit());
+            }
+
+            return result;
+        }
+
         [[nodiscard]] inline bool stopped() const final {
             return std::ranges::any_of(m_limiters, [&](const auto& limiter) { return limiter->stopped(); });
         }
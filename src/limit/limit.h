@@ -20,7 +20,11 @@
 
 #include "../types.h"
 
+#include <limits>
+#include <optional>
+
 #include "../search_fwd.h"
+#include "../util/timer.h"
 
 namespace stormphrax::limit {
     class ISearchLimiter {
@@ -30,8 +34,19 @@ namespace stormphrax::limit {
         virtual void update(const search::SearchData& data, Score score, Move bestMove, usize totalNodes) {}
         virtual void updateMoveNodes(Move move, usize nodes) {}
 
+        // Only called between iterations, and on the main thread once
+        // hardNodeLimit() has been reached. Hard time limits are enforced
+        // by the searcher's timer thread instead, via hardDeadline()
         [[nodiscard]] virtual bool stop(const search::SearchData& data, bool allowSoftTimeout) = 0;
 
+        [[nodiscard]] virtual std::optional<util::Instant> hardDeadline() const {
+            return {};
+        }
+
+        [[nodiscard]] virtual usize hardNodeLimit() const {
+            return std::numeric_limits<usize>::max();
+        }
+
         [[nodiscard]] virtual bool stopped() const = 0;
     };
 } // namespace stormphrax::limit
@@ -31,7 +31,7 @@ namespace stormphrax::limit {
             m_endTime{Instant::now() + static_cast<f64>(std::max<i64>(1, time - overhead)) / 1000.0} {}
 
     bool MoveTimeLimiter::stop(const search::SearchData& data, bool allowSoftTimeout) {
-        if (data.rootDepth > 2 && data.nodes > 0 && (data.nodes % 1024) == 0 && Instant::now() >= m_endTime) {
+        if (Instant::now() >= m_endTime) {
             m_stopped.store(true, std::memory_order_release);
             return true;
         }
@@ -39,6 +39,10 @@ namespace stormphrax::limit {
         return false;
     }
 
+    std::optional<Instant> MoveTimeLimiter::hardDeadline() const {
+        return m_endTime;
+    }
+
     bool MoveTimeLimiter::stopped() const {
         return m_stopped.load(std::memory_order_acquire);
     }
@@ -108,10 +112,6 @@ namespace stormphrax::limit {
     }
 
     bool TimeManager::stop(const search::SearchData& data, bool allowSoftTimeout) {
-        if (data.nodes == 0 || (!allowSoftTimeout && (data.nodes % 1024) != 0)) {
-            return false;
-        }
-
         const auto elapsed = m_startTime.elapsed();
 
         if (elapsed > m_maxTime || (allowSoftTimeout && elapsed > m_softTime * m_scale)) {
@@ -122,6 +122,10 @@ namespace stormphrax::limit {
         return false;
     }
 
+    std::optional<Instant> TimeManager::hardDeadline() const {
+        return m_startTime + m_maxTime;
+    }
+
     bool TimeManager::stopped() const {
         return m_stopped.load(std::memory_order_acquire);
     }
@@ -40,6 +40,8 @@ namespace stormphrax::limit {
 
         [[nodiscard]] bool stop(const search::SearchData& data, bool allowSoftTimeout) final;
 
+        [[nodiscard]] std::optional<util::Instant> hardDeadline() const final;
+
         [[nodiscard]] bool stopped() const final;
 
     private:
@@ -57,6 +59,8 @@ namespace stormphrax::limit {
 
         [[nodiscard]] bool stop(const search::SearchData& data, bool allowSoftTimeout) final;
 
+        [[nodiscard]] std::optional<util::Instant> hardDeadline() const final;
+
         [[nodiscard]] bool stopped() const final;
 
     private:
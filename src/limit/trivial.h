@@ -56,9 +56,7 @@ namespace stormphrax::limit {
             //   - no soft limit
             //   - hard limit: m_maxNodes
 
-            const auto hardLimit = m_maxNodes * (g_opts.softNodes ? g_opts.softNodeHardLimitMultiplier : 1);
-
-            if (data.nodes >= hardLimit || (g_opts.softNodes && allowSoftTimeout && data.nodes >= m_maxNodes)) {
+            if (data.nodes >= hardNodeLimit() || (g_opts.softNodes && allowSoftTimeout && data.nodes >= m_maxNodes)) {
                 m_stopped.store(true, std::memory_order_release);
                 return true;
             }
@@ -66,6 +64,10 @@ namespace stormphrax::limit {
             return false;
         }
 
+        [[nodiscard]] inline usize hardNodeLimit() const final {
+            return m_maxNodes * (g_opts.softNodes ? g_opts.softNodeHardLimitMultiplier : 1);
+        }
+
         [[nodiscard]] inline bool stopped() const final {
             return m_stopped.load(std::memory_order_acquire);
         }
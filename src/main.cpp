@@ -19,11 +19,13 @@
 #include "bench.h"
 #include "cuckoo.h"
 #include "datagen/datagen.h"
+#include "eval/batch.h"
 #include "eval/nnue.h"
 #include "tunable.h"
 #include "uci.h"
 #include "util/ctrlc.h"
 #include "util/parse.h"
+#include "util/timer.h"
 
 #if SP_EXTERNAL_TUNE
     #include "util/split.h"
@@ -37,12 +39,14 @@ i32 main(i32 argc, const char* argv[]) {
     tunable::init();
     cuckoo::init();
 
-    eval::loadDefaultNetwork();
-
+    // uci mode loads the default network lazily, so that
+    // a network cache can be loaded without decompressing it first
     if (argc > 1) {
         const std::string_view mode{argv[1]};
 
         if (mode == "bench") {
+            eval::loadDefaultNetwork();
+
             search::Searcher searcher{bench::kDefaultBenchTtSize};
             bench::run(searcher);
 
@@ -82,7 +86,80 @@ i32 main(i32 argc, const char* argv[]) {
                 tbPath = std::string_view{argv[6]};
             }
 
+            eval::loadDefaultNetwork();
+
             return datagen::run(printUsage, argv[2], dfrc, argv[4], static_cast<i32>(threads), tbPath);
+        } else if (mode == "netcache") {
+            if (argc < 3) {
+                eprintln("usage: {} netcache <output> [network file]", argv[0]);
+                return 1;
+            }
+
+            // never fall back to the embedded network when another one was asked for
+            if (argc > 3) {
+                if (!eval::loadNetwork(argv[3])) {
+                    return 1;
+                }
+            } else {
+                eval::ensureNetworkLoaded();
+            }
+
+            return eval::writeNetworkCache(argv[2]) ? 0 : 1;
+        } else if (mode == "evalbatch") {
+            if (argc < 3) {
+                eprintln("usage: {} evalbatch <epd file> [threads] [network file]", argv[0]);
+                return 1;
+            }
+
+            u32 threads = 1;
+            if (argc > 3 && !util::tryParse<u32>(threads, argv[3])) {
+                eprintln("invalid number of threads {}", argv[3]);
+                return 1;
+            }
+
+            const auto fens = bench::loadFens(argv[2]);
+
+            if (!fens) {
+                return 1;
+            }
+
+            std::vector<Position> positions{};
+            positions.reserve(fens->size());
+
+            for (const auto& fen : *fens) {
+                if (const auto pos = Position::fromFen(fen)) {
+                    positions.push_back(*pos);
+                } else {
+                    eprintln("invalid fen {}", fen);
+                    return 1;
+                }
+            }
+
+            if (argc > 4) {
+                if (!eval::loadNetwork(argv[4])) {
+                    return 1;
+                }
+            } else {
+                eval::ensureNetworkLoaded();
+            }
+
+            const auto start = util::Instant::now();
+            const auto evals = eval::staticEvalBatch(positions, threads);
+            const auto time = start.elapsed();
+
+            for (usize i = 0; i < positions.size(); ++i) {
+                println("{} | {}", (*fens)[i], evals[i]);
+            }
+
+            // stderr, to keep stdout parseable
+            eprintln(
+                "evaluated {} positions in {:.3f} seconds ({:.0f} evals/s)",
+                positions.size(),
+                time,
+                static_cast<f64>(positions.size()) / std::max(time, 0.000001)
+            );
+
+            return 0;
         }
 #if SP_EXTERNAL_TUNE
         else if (mode == "printwf" || mode == "printctt" || mode == "printob")
@@ -0,0 +1,518 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+// Standalone microbenchmarks for the engine's hot kernels, built as a separate
+// binary (make microbench, or the stormphrax-microbench CMake target).
+//
+// usage: stormphrax-microbench [--reps <n>] [--warmup <n>] [--epd <file>] [filter]
+//
+// Kernels run over a corpus built from short random playouts of the bench
+// positions (or the positions in an EPD file), and report ns/op statistics
+// over the repetitions. Only kernels whose name contains filter are run.
+
+#include "../types.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../attacks/attacks.h"
+#include "../bench.h"
+#include "../cuckoo.h"
+#include "../eval/batch.h"
+#include "../eval/eval.h"
+#include "../eval/nnue.h"
+#include "../movegen.h"
+#include "../position/position.h"
+#include "../see.h"
+#include "../ttable.h"
+#include "../tunable.h"
+#include "../util/parse.h"
+#include "../util/rng.h"
+#include "../util/timer.h"
+
+using namespace stormphrax;
+
+namespace {
+    constexpr u32 kDefaultReps = 15;
+    constexpr u32 kDefaultWarmupReps = 3;
+
+    constexpr i32 kPlayoutPlies = 24;
+    constexpr u64 kCorpusSeed = 0x5eed0fc0ffee1234;
+
+    constexpr usize kTtSizeMib = 64;
+
+    // keeps the compiler from optimising away results that are never used
+    template <typename T>
+    inline void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Config {
+        u32 reps{kDefaultReps};
+        u32 warmupReps{kDefaultWarmupReps};
+        std::optional<std::string> epdPath{};
+        std::string filter{};
+    };
+
+    struct CorpusEntry {
+        Position pos;
+        // keys of the preceding positions in the playout, as in a search's key history
+        std::vector<u64> keyHistory;
+        std::vector<Move> legalMoves;
+    };
+
+    // sub/add feature pairs from quiet non-king moves, and sub/sub/add from captures
+    struct FeatureUpdates {
+        std::vector<std::array<u32, 2>> subAdd{};
+        std::vector<std::array<u32, 3>> subSubAdd{};
+    };
+
+    std::vector<Move> legalMoves(const Position& pos) {
+        ScoredMoveList moves{};
+        generateAll(moves, pos);
+
+        std::vector<Move> legal{};
+
+        for (const auto& scored : moves) {
+            if (pos.isLegal(scored.move)) {
+                legal.push_back(scored.move);
+            }
+        }
+
+        return legal;
+    }
+
+    std::vector<CorpusEntry> buildCorpus(const std::vector<std::string>& fens) {
+        util::rng::Jsf64Rng rng{kCorpusSeed};
+
+        std::vector<CorpusEntry> corpus{};
+
+        for (const auto& fen : fens) {
+            auto pos = Position::fromFen(fen);
+
+            if (!pos) {
+                eprintln("invalid fen {}", fen);
+                continue;
+            }
+
+            std::vector<u64> keyHistory{};
+
+            for (i32 ply = 0; ply <= kPlayoutPlies; ++ply) {
+                auto moves = legalMoves(*pos);
+
+                if (moves.empty()) {
+                    break;
+                }
+
+                const auto move = moves[rng.nextU32(static_cast<u32>(moves.size()))];
+
+                corpus.push_back({*pos, keyHistory, std::move(moves)});
+
+                keyHistory.push_back(pos->key());
+                pos = pos->applyMove(move);
+            }
+        }
+
+        return corpus;
+    }
+
+    FeatureUpdates collectFeatureUpdates(const std::vector<CorpusEntry>& corpus) {
+        FeatureUpdates updates{};
+
+        for (const auto& entry : corpus) {
+            const auto& boards = entry.pos.boards();
+
+            for (const auto c : {Color::kBlack, Color::kWhite}) {
+                const auto king = entry.pos.kings().color(c);
+
+                for (const auto move : entry.legalMoves) {
+                    const auto moving = boards.pieceOn(move.fromSq());
+
+                    if (move.type() != MoveType::kStandard || pieceType(moving) == PieceType::kKing) {
+                        continue;
+                    }
+
+                    const auto sub = eval::NnueState::featureIndex(c, moving, move.fromSq(), king);
+                    const auto add = eval::NnueState::featureIndex(c, moving, move.toSq(), king);
+
+                    if (const auto captured = boards.pieceOn(move.toSq()); captured != Piece::kNone) {
+                        const auto sub1 = eval::NnueState::featureIndex(c, captured, move.toSq(), king);
+                        updates.subSubAdd.push_back({sub, sub1, add});
+                    } else {
+                        updates.subAdd.push_back({sub, add});
+                    }
+                }
+            }
+        }
+
+        return updates;
+    }
+
+    class Runner {
+    public:
+        explicit Runner(const Config& config) :
+                m_config{config} {
+            println(
+                "{:<24} {:>10} {:>10} {:>10} {:>10} {:>10} {:>7}",
+                "kernel",
+                "ops/rep",
+                "mean ns",
+                "median ns",
+                "stddev",
+                "min ns",
+                "cv"
+            );
+        }
+
+        // f runs one repetition and returns the number of operations it performed
+        template <typename F>
+        void run(std::string_view name, F&& f) {
+            if (!m_config.filter.empty() && name.find(m_config.filter) == std::string_view::npos) {
+                return;
+            }
+
+            usize ops{};
+
+            for (u32 rep = 0; rep < m_config.warmupReps; ++rep) {
+                ops = f();
+            }
+
+            std::vector<f64> samples{};
+            samples.reserve(m_config.reps);
+
+            for (u32 rep = 0; rep < m_config.reps; ++rep) {
+                const auto start = util::Instant::now();
+                ops = f();
+                const auto time = start.elapsed();
+
+                samples.push_back(time * 1000000000.0 / static_cast<f64>(std::max<usize>(ops, 1)));
+            }
+
+            const auto summary = bench::summarize(samples);
+
+            println(
+                "{:<24} {:>10} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>6.2f}%",
+                name,
+                ops,
+                summary.mean,
+                summary.median,
+                summary.stddev,
+                summary.min,
+                summary.mean > 0.0 ? summary.stddev * 100.0 / summary.mean : 0.0
+            );
+        }
+
+    private:
+        const Config& m_config;
+    };
+
+    void runAll(const Config& config, const std::vector<CorpusEntry>& corpus) {
+        // allocated up front, so that its info output does not land in the middle of the table
+        TTable ttable{kTtSizeMib};
+        ttable.finalize();
+
+        Runner runner{config};
+
+        usize totalMoves{};
+        for (const auto& entry : corpus) {
+            totalMoves += entry.legalMoves.size();
+        }
+
+        runner.run("generateAll", [&] {
+            ScoredMoveList moves{};
+            for (const auto& entry : corpus) {
+                moves.clear();
+                generateAll(moves, entry.pos);
+                doNotOptimize(moves.size());
+            }
+            return corpus.size();
+        });
+
+        runner.run("generateNoisy", [&] {
+            ScoredMoveList moves{};
+            for (const auto& entry : corpus) {
+                moves.clear();
+                generateNoisy(moves, entry.pos);
+                doNotOptimize(moves.size());
+            }
+            return corpus.size();
+        });
+
+        auto nnueState = std::make_unique<eval::NnueState>();
+
+        // the update kernels cost the same whatever the accumulator holds,
+        // so the state is not reset for each position
+        nnueState->reset(corpus[0].pos.bbs(), corpus[0].pos.kings());
+
+        runner.run("applyMove<kNone>", [&] {
+            for (const auto& entry : corpus) {
+                for (const auto move : entry.legalMoves) {
+                    const auto newPos = entry.pos.applyMove<NnueUpdateAction::kNone>(move);
+                    doNotOptimize(newPos.key());
+                }
+            }
+            return totalMoves;
+        });
+
+        runner.run("applyMove<kQueue>", [&] {
+            for (const auto& entry : corpus) {
+                for (const auto move : entry.legalMoves) {
+                    const auto newPos = entry.pos.applyMove<NnueUpdateAction::kQueue>(move, nnueState.get());
+                    nnueState->pop();
+                    doNotOptimize(newPos.key());
+                }
+            }
+            return totalMoves;
+        });
+
+        runner.run("applyMove<kApply>", [&] {
+            for (const auto& entry : corpus) {
+                for (const auto move : entry.legalMoves) {
+                    const auto newPos = entry.pos.applyMove<NnueUpdateAction::kApply>(move, nnueState.get());
+                    doNotOptimize(newPos.key());
+                }
+            }
+            return totalMoves;
+        });
+
+        const auto updates = collectFeatureUpdates(corpus);
+        const auto& ft = eval::g_network->featureTransformer();
+
+        auto src = std::make_unique<eval::Accumulator>();
+        auto dst = std::make_unique<eval::Accumulator>();
+
+        eval::NnueState::initAccumulator(*src, corpus[0].pos.bbs(), corpus[0].pos.kings());
+
+        runner.run("subAddFrom", [&] {
+            for (usize i = 0; i < updates.subAdd.size(); ++i) {
+                const auto [sub, add] = updates.subAdd[i];
+                dst->subAddFrom(*src, ft, static_cast<Color>(i & 1), sub, add);
+                doNotOptimize(*dst);
+            }
+            return updates.subAdd.size();
+        });
+
+        runner.run("subSubAddFrom", [&] {
+            for (usize i = 0; i < updates.subSubAdd.size(); ++i) {
+                const auto [sub0, sub1, add] = updates.subSubAdd[i];
+                dst->subSubAddFrom(*src, ft, static_cast<Color>(i & 1), sub0, sub1, add);
+                doNotOptimize(*dst);
+            }
+            return updates.subSubAdd.size();
+        });
+
+        runner.run("updateBothFrom<1, 1>", [&] {
+            for (usize i = 0; i + 1 < updates.subAdd.size(); i += 2) {
+                const auto [blackSub, blackAdd] = updates.subAdd[i];
+                const auto [whiteSub, whiteAdd] = updates.subAdd[i + 1];
+                dst->updateBothFrom<1, 1>(*src, ft, {{{blackAdd}, {whiteAdd}}}, {{{blackSub}, {whiteSub}}});
+                doNotOptimize(*dst);
+            }
+            return updates.subAdd.size() / 2;
+        });
+
+        // NnueState::reset refreshes both perspectives through the refresh table,
+        // consecutive corpus positions come from the same playout like in a search
+        runner.run("refreshAccumulator x2", [&] {
+            for (const auto& entry : corpus) {
+                nnueState->reset(entry.pos.bbs(), entry.pos.kings());
+            }
+            return corpus.size();
+        });
+
+        std::vector<eval::Accumulator> accumulators(corpus.size());
+
+        for (usize i = 0; i < corpus.size(); ++i) {
+            eval::NnueState::initAccumulator(accumulators[i], corpus[i].pos.bbs(), corpus[i].pos.kings());
+        }
+
+        runner.run("propagate", [&] {
+            for (usize i = 0; i < corpus.size(); ++i) {
+                const auto& pos = corpus[i].pos;
+                const auto stm = pos.stm();
+
+                const auto output = eval::g_network->propagate(
+                    pos.bbs(),
+                    accumulators[i].forColor(stm),
+                    accumulators[i].forColor(oppColor(stm))
+                );
+
+                doNotOptimize(output[0]);
+            }
+            return corpus.size();
+        });
+
+        std::vector<Position> batchPositions{};
+        batchPositions.reserve(corpus.size());
+
+        for (const auto& entry : corpus) {
+            batchPositions.push_back(entry.pos);
+        }
+
+        std::vector<Score> batchEvals(batchPositions.size());
+
+        runner.run("staticEvalOnce", [&] {
+            for (const auto& pos : batchPositions) {
+                doNotOptimize(eval::staticEvalOnce(pos));
+            }
+            return batchPositions.size();
+        });
+
+        runner.run("staticEvalBatch", [&] {
+            eval::staticEvalBatch(batchPositions, batchEvals);
+            doNotOptimize(batchEvals.front());
+            return batchPositions.size();
+        });
+
+        // the corpus positions and all of their children
+        std::vector<u64> ttKeys{};
+
+        for (const auto& entry : corpus) {
+            ttKeys.push_back(entry.pos.key());
+            for (const auto move : entry.legalMoves) {
+                ttKeys.push_back(entry.pos.applyMove(move).key());
+            }
+        }
+
+        runner.run("TTable::put", [&] {
+            for (const auto key : ttKeys) {
+                const auto depth = static_cast<i32>(key % 32);
+                const auto score = static_cast<Score>(key % 512) - 256;
+                ttable.put(key, score, score, kNullMove, depth, 0, TtFlag::kExact, false);
+            }
+            return ttKeys.size();
+        });
+
+        runner.run("TTable::probe", [&] {
+            ProbedTTableEntry entry{};
+            for (const auto key : ttKeys) {
+                doNotOptimize(ttable.probe(entry, key, 0));
+            }
+            return ttKeys.size();
+        });
+
+        runner.run("see", [&] {
+            for (const auto& entry : corpus) {
+                for (const auto move : entry.legalMoves) {
+                    doNotOptimize(see::see(entry.pos, move, 0));
+                }
+            }
+            return totalMoves;
+        });
+
+        runner.run("hasCycle", [&] {
+            for (const auto& entry : corpus) {
+                const auto ply = static_cast<i32>(entry.keyHistory.size());
+                doNotOptimize(entry.pos.hasCycle(ply, entry.keyHistory));
+            }
+            return corpus.size();
+        });
+
+        runner.run("rook attacks", [&] {
+            for (const auto& entry : corpus) {
+                const auto occupancy = entry.pos.bbs().occupancy();
+                for (u32 sq = 0; sq < 64; ++sq) {
+                    doNotOptimize(attacks::getRookAttacks(static_cast<Square>(sq), occupancy));
+                }
+            }
+            return corpus.size() * 64;
+        });
+
+        runner.run("bishop attacks", [&] {
+            for (const auto& entry : corpus) {
+                const auto occupancy = entry.pos.bbs().occupancy();
+                for (u32 sq = 0; sq < 64; ++sq) {
+                    doNotOptimize(attacks::getBishopAttacks(static_cast<Square>(sq), occupancy));
+                }
+            }
+            return corpus.size() * 64;
+        });
+    }
+
+    void printUsage(const char* name) {
+        eprintln("usage: {} [--reps <n>] [--warmup <n>] [--epd <file>] [filter]", name);
+    }
+} // namespace
+
+i32 main(i32 argc, const char* argv[]) {
+    tunable::init();
+    cuckoo::init();
+
+    eval::loadDefaultNetwork();
+
+    Config config{};
+
+    for (i32 i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--reps" && i + 1 < argc) {
+            if (!util::tryParse<u32>(config.reps, argv[++i]) || config.reps == 0) {
+                eprintln("invalid rep count {}", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            if (!util::tryParse<u32>(config.warmupReps, argv[++i])) {
+                eprintln("invalid warmup rep count {}", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--epd" && i + 1 < argc) {
+            config.epdPath = std::string{argv[++i]};
+        } else if (arg.starts_with("--")) {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            config.filter = arg;
+        }
+    }
+
+    std::vector<std::string> fens{};
+
+    if (config.epdPath) {
+        if (auto loaded = bench::loadFens(*config.epdPath)) {
+            fens = std::move(*loaded);
+        } else {
+            return 1;
+        }
+    } else {
+        for (const auto fen : bench::standardFens()) {
+            fens.emplace_back(fen);
+        }
+    }
+
+    const auto corpus = buildCorpus(fens);
+
+    if (corpus.empty()) {
+        eprintln("no positions to benchmark");
+        return 1;
+    }
+
+    println(
+        "info string {} positions from {} roots, {} reps after {} warmup",
+        corpus.size(),
+        fens.size(),
+        config.reps,
+        config.warmupReps
+    );
+
+    runAll(config, corpus);
+
+    return 0;
+}
@@ -23,6 +23,7 @@
 
 #include "attacks/attacks.h"
 #include "opts.h"
+#include "profiler.h"
 #include "rays.h"
 #include "util/bitfield.h"
 
@@ -333,6 +334,8 @@ namespace stormphrax {
     } // namespace
 
     void generateNoisy(ScoredMoveList& noisy, const Position& pos) {
+        const profiler::ScopedTimer timer{profiler::Component::kGenerateNoisy};
+
         const auto& bbs = pos.bbs();
 
         const auto us = pos.stm();
@@ -380,6 +383,8 @@ namespace stormphrax {
     }
 
     void generateQuiet(ScoredMoveList& quiet, const Position& pos) {
+        const profiler::ScopedTimer timer{profiler::Component::kGenerateQuiet};
+
         const auto& bbs = pos.bbs();
 
         const auto us = pos.stm();
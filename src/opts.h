@@ -32,12 +32,31 @@ namespace stormphrax {
 
         constexpr i32 kDefaultNormalizedContempt = 0;
 
+        enum class SmpMode : u8 {
+            // threads only share the TT
+            kLazy = 0,
+            // threads additionally defer moves that another thread is searching
+            kAbdada,
+        };
+
         struct GlobalOptions {
             u32 threads{kDefaultThreadCount};
+            SmpMode smpMode{SmpMode::kLazy};
+
+            bool hashScrub{false};
+            bool preserveHashOnResize{false};
+            // store static evals in the TT on a TT miss
+            bool ttEvalWrites{true};
 
             bool chess960{false};
             bool showWdl{true};
             bool showCurrMove{false};
+            // print the time from go until each thread reaches the root node
+            bool showStartLatency{false};
+
+            // only controls printing a ponder move with bestmove,
+            // go ponder is supported regardless
+            bool ponder{false};
 
             u32 multiPv{1};
 
@@ -50,6 +69,9 @@ namespace stormphrax {
             i32 syzygyProbeDepth{1};
             i32 syzygyProbeLimit{7};
 
+            // place the network in shared memory, to share it with other engine processes
+            bool sharedNetwork{false};
+
             i32 contempt{wdl::unnormalizeScoreMaterial58(kDefaultNormalizedContempt)};
         };
 
@@ -25,6 +25,7 @@
 #include "../cuckoo.h"
 #include "../movegen.h"
 #include "../opts.h"
+#include "../profiler.h"
 #include "../rays.h"
 #include "../util/parse.h"
 #include "../util/split.h"
@@ -134,6 +135,8 @@ namespace stormphrax {
 
     template <NnueUpdateAction kNnueAction>
     Position Position::applyMove(Move move, eval::NnueState* nnueState) const {
+        const profiler::ScopedTimer timer{profiler::Component::kApplyMove};
+
         static constexpr bool kUpdateNnue = kNnueAction != NnueUpdateAction::kNone;
 
         if constexpr (kUpdateNnue) {
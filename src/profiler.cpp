@@ -0,0 +1,77 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "profiler.h"
+
+namespace stormphrax::profiler {
+    void print(usize nodes, u64 totalTicks) {
+        if constexpr (!kEnabled) {
+            return;
+        }
+
+        std::array<u64, kComponentCount> ticks{};
+        std::array<u64, kComponentCount> calls{};
+
+        detail::Shards::forEach([&](const detail::Shard& shard) {
+            for (usize i = 0; i < kComponentCount; ++i) {
+                ticks[i] += shard.ticks[i].load(std::memory_order::relaxed);
+                calls[i] += shard.calls[i].load(std::memory_order::relaxed);
+            }
+        });
+
+        const auto perNode = [nodes](u64 v) {
+            return nodes > 0 ? static_cast<f64>(v) / static_cast<f64>(nodes) : 0.0;
+        };
+
+        println("info string profile in {}, timings are inclusive", kTickUnit);
+        println(
+            "{:<16} {:>12} {:>11} {:>11} {:>11} {:>8}",
+            "component",
+            "calls",
+            "calls/node",
+            "per call",
+            "per node",
+            "share"
+        );
+
+        for (usize i = 0; i < kComponentCount; ++i) {
+            const auto perCall = calls[i] > 0 ? static_cast<f64>(ticks[i]) / static_cast<f64>(calls[i]) : 0.0;
+            const auto share = totalTicks > 0 ? static_cast<f64>(ticks[i]) * 100.0 / static_cast<f64>(totalTicks) : 0.0;
+
+            println(
+                "{:<16} {:>12} {:>11.3f} {:>11.1f} {:>11.1f} {:>7.2f}%",
+                kComponentNames[i],
+                calls[i],
+                perNode(calls[i]),
+                perCall,
+                perNode(ticks[i]),
+                share
+            );
+        }
+
+        println("{:<16} {:>12} {:>11} {:>11} {:>11.1f}", "total", "", "", "", perNode(totalTicks));
+    }
+
+    void reset() {
+        detail::Shards::forEach([](detail::Shard& shard) {
+            for (usize i = 0; i < kComponentCount; ++i) {
+                shard.ticks[i].store(0, std::memory_order::relaxed);
+                shard.calls[i].store(0, std::memory_order::relaxed);
+            }
+        });
+    }
+} // namespace stormphrax::profiler
@@ -0,0 +1,134 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "types.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
+#include "util/thread_shards.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define SP_PROFILER_HAS_RDTSC 1
+#else
+    #define SP_PROFILER_HAS_RDTSC 0
+#endif
+
+namespace stormphrax::profiler {
+#if SP_PROFILE
+    constexpr bool kEnabled = true;
+#else
+    constexpr bool kEnabled = false;
+#endif
+
+    enum class Component : u8 {
+        kGenerateNoisy = 0,
+        kGenerateQuiet,
+        kApplyMove,
+        kNnueUpdate,
+        kNnuePropagate,
+        kTtProbe,
+        kSee,
+        kCount,
+    };
+
+    constexpr auto kComponentCount = static_cast<usize>(Component::kCount);
+
+    constexpr std::array<std::string_view, kComponentCount> kComponentNames{
+        "generateNoisy",
+        "generateQuiet",
+        "applyMove",
+        "ensureUpToDate",
+        "propagate",
+        "TTable::probe",
+        "see",
+    };
+
+    // rdtsc counts at a constant reference rate, not core clock cycles,
+    // but it is invariant on anything recent and is the cheapest timer by far
+    constexpr std::string_view kTickUnit = SP_PROFILER_HAS_RDTSC ? "cycles" : "ns";
+
+    [[nodiscard]] inline u64 ticks() {
+#if SP_PROFILER_HAS_RDTSC
+        return __rdtsc();
+#else
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+    }
+
+    namespace detail {
+        // one per thread, summed when printing, same scheme as stats shards
+        struct alignas(64) Shard {
+            std::array<std::atomic<u64>, kComponentCount> ticks{};
+            std::array<std::atomic<u64>, kComponentCount> calls{};
+        };
+
+        using Shards = util::ThreadShards<Shard>;
+
+        [[nodiscard]] inline Shard& localShard() {
+            return Shards::local();
+        }
+    } // namespace detail
+
+    // Accumulates the ticks spent in its scope against a component. Timings are
+    // inclusive, so nested components are counted in their callers too.
+    // Does nothing at all unless SP_PROFILE is enabled
+    class ScopedTimer {
+    public:
+        explicit inline ScopedTimer([[maybe_unused]] Component component) {
+            if constexpr (kEnabled) {
+                m_component = component;
+                m_start = ticks();
+            }
+        }
+
+        inline ~ScopedTimer() {
+            if constexpr (kEnabled) {
+                const auto elapsed = ticks() - m_start;
+
+                auto& shard = detail::localShard();
+                const auto idx = static_cast<usize>(m_component);
+
+                // only ever written by this thread
+                auto& total = shard.ticks[idx];
+                auto& calls = shard.calls[idx];
+
+                total.store(total.load(std::memory_order::relaxed) + elapsed, std::memory_order::relaxed);
+                calls.store(calls.load(std::memory_order::relaxed) + 1, std::memory_order::relaxed);
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer(ScopedTimer&&) = delete;
+
+    private:
+        Component m_component{};
+        u64 m_start{};
+    };
+
+    // prints per-call and per-node costs of each component, and their share of totalTicks
+    void print(usize nodes, u64 totalTicks);
+
+    // not thread safe, only call while not searching
+    void reset();
+} // namespace stormphrax::profiler
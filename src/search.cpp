@@ -19,6 +19,9 @@
 #include "search.h"
 
 #include <cmath>
+#include <fstream>
+#include <numeric>
+#include <type_traits>
 
 #include "3rdparty/pyrrhic/tbprobe.h"
 #include "limit/trivial.h"
@@ -26,7 +29,10 @@
 #include "see.h"
 #include "stats.h"
 #include "tb.h"
+#include "tracer.h"
 #include "uci.h"
+#include "util/mapped_file.h"
+#include "util/rng.h"
 
 namespace stormphrax::search {
     using namespace stormphrax::tunable;
@@ -37,6 +43,9 @@ namespace stormphrax::search {
         constexpr f64 kWidenReportDelay = 1.0;
         constexpr f64 kCurrmoveReportDelay = 2.5;
 
+        // shallower subtrees are cheaper to search twice than to coordinate
+        constexpr i32 kAbdadaMinDepth = 3;
+
         // [improving][clamped depth]
         constexpr auto kLmpTable = [] {
             util::MultiArray<i32, 2, 16> result{};
@@ -50,10 +59,63 @@ namespace stormphrax::search {
             return result;
         }();
 
+        // where the node budget goes, only counted in SP_STATS builds
+        const stats::DepthCounter s_ttCutoffs{"tt cutoff"};
+        const stats::DepthCounter s_rfpCutoffs{"rfp"};
+        const stats::DepthCounter s_standPatCutoffs{"stand pat"};
+        const stats::DepthCounter s_razoringCutoffs{"razoring"};
+        const stats::DepthCounter s_nmpSearches{"nmp search"};
+        const stats::DepthCounter s_nmpCutoffs{"nmp cutoff"};
+        const stats::DepthCounter s_nmpVerifications{"nmp verification"};
+        const stats::DepthCounter s_nmpVerifiedCutoffs{"nmp verified cutoff"};
+        const stats::DepthCounter s_probcutCutoffs{"probcut"};
+        const stats::DepthCounter s_lmpPrunes{"lmp"};
+        const stats::DepthCounter s_quietHistPrunes{"quiet history pruning"};
+        const stats::DepthCounter s_noisyHistPrunes{"noisy history pruning"};
+        const stats::DepthCounter s_futilityPrunes{"futility"};
+        const stats::DepthCounter s_seePrunes{"see pruning"};
+        const stats::DepthCounter s_singularSearches{"singular search"};
+        const stats::DepthCounter s_singularExtensions{"singular extension"};
+        const stats::DepthCounter s_doubleExtensions{"double extension"};
+        const stats::DepthCounter s_tripleExtensions{"triple extension"};
+        const stats::DepthCounter s_multicutCutoffs{"multicut"};
+        const stats::DepthCounter s_negativeExtensions{"negative extension"};
+        const stats::DepthCounter s_ldseExtensions{"low depth singular ext"};
+        const stats::DepthCounter s_lmrSearches{"lmr search"};
+        const stats::DepthCounter s_lmrResearches{"lmr re-search"};
+        const stats::DepthCounter s_pvsResearches{"pvs re-search"};
+
+        constexpr std::array kStateFileMagic{'S', 'P', 'S', 'S'};
+        constexpr u16 kStateFileVersion = 2;
+
+        // followed by the TT, then each thread's history and correction history tables
+        struct StateFileHeader {
+            std::array<char, 4> magic{};
+            u16 version{};
+            [[maybe_unused]] u16 padding{};
+            u64 networkHash{};
+            u64 ttClusterCount{};
+            u32 ttClusterSize{};
+            u32 threadCount{};
+            u32 historySize{};
+            u32 correctionHistorySize{};
+        };
+
+        static_assert(sizeof(StateFileHeader) == 40);
+
+        static_assert(std::is_trivially_copyable_v<HistoryTables>);
+        static_assert(std::is_trivially_copyable_v<CorrectionHistoryTable>);
+
         [[nodiscard]] constexpr Score drawScore(usize nodes) {
             return 2 - static_cast<Score>(nodes % 4);
         }
 
+        // shows up as a barrier wait span in the trace, in SP_TRACE builds
+        inline void arriveAndWaitTraced(util::Barrier& barrier, const char* name) {
+            const tracer::Span span{tracer::Event::kBarrierWait, name};
+            barrier.arriveAndWait();
+        }
+
         inline void generateLegal(MoveList& moves, const Position& pos) {
             ScoredMoveList generated{};
             generateAll(generated, pos);
@@ -71,7 +133,9 @@ namespace stormphrax::search {
     } // namespace
 
     Searcher::Searcher(usize ttSizeMib) :
-            m_ttable{ttSizeMib}, m_startTime{Instant::now()} {
+            m_ttable{ttSizeMib}, m_numa{util::numa::enabled(util::numa::Mode::kAuto)}, m_startTime{Instant::now()} {
+        m_ttable.setInterleaved(m_numa);
+
         auto& thread = m_threads.emplace_back();
 
         thread.id = 0;
@@ -80,18 +144,23 @@ namespace stormphrax::search {
 
     void Searcher::newGame() {
         // Finalisation (init) clears the TT, so don't clear it twice
-        if (!m_ttable.finalize()) {
-            m_ttable.clear();
+        if (!finalizeTt()) {
+            clearTt();
         }
 
         for (auto& thread : m_threads) {
             thread.history.clear();
             thread.correctionHistory.clear();
+            thread.evalCache.clear();
+
+#if SP_TT_STATS
+            thread.ttStats = {};
+#endif
         }
     }
 
     void Searcher::ensureReady() {
-        m_ttable.finalize();
+        finalizeTt();
     }
 
     void Searcher::startSearch(
@@ -101,7 +170,8 @@ namespace stormphrax::search {
         i32 maxDepth,
         std::span<Move> moves,
         std::unique_ptr<limit::ISearchLimiter> limiter,
-        bool infinite
+        bool infinite,
+        bool ponder
     ) {
         if (!m_limiter && !limiter) {
             eprintln("mising limiter");
@@ -110,7 +180,7 @@ namespace stormphrax::search {
 
         const auto initStart = Instant::now();
 
-        if (m_ttable.finalize()) {
+        if (finalizeTt()) {
             const auto initTime = initStart.elapsed();
             println(
                 "info string No ucinewgame or isready before go, lost {} ms to TT initialization",
@@ -118,11 +188,17 @@ namespace stormphrax::search {
             );
         }
 
-        m_resetBarrier.arriveAndWait();
+        m_ttable.stopScrub();
+
+        arriveAndWaitTraced(m_resetBarrier, "reset");
 
         m_infinite = infinite;
         m_maxDepth = maxDepth;
 
+        m_pondering.store(ponder, std::memory_order::relaxed);
+        m_ponderhitPending.store(false, std::memory_order::relaxed);
+        m_ponderhitLimiter.reset();
+
         m_minRootScore = -kScoreInf;
         m_maxRootScore = kScoreInf;
 
@@ -148,6 +224,14 @@ namespace stormphrax::search {
             m_limiter = std::move(limiter);
         }
 
+        m_hardNodeLimit.store(m_limiter->hardNodeLimit(), std::memory_order::relaxed);
+
+        m_abdada = g_opts.smpMode == opts::SmpMode::kAbdada && m_threads.size() > 1;
+
+        if (m_abdada && !m_abdadaTable) {
+            m_abdadaTable = std::make_unique<AbdadaTable>();
+        }
+
         const auto contempt = g_opts.contempt;
 
         m_contempt[static_cast<i32>(pos.stm())] = contempt;
@@ -155,8 +239,10 @@ namespace stormphrax::search {
 
         m_setupInfo.rootPos = pos;
 
-        m_setupInfo.keyHistorySize = util::pad<usize{256}>(keyHistory.size());
-        m_setupInfo.keyHistory = keyHistory;
+        // positions before the last irreversible move can never be repeated,
+        // so the search threads only need to copy the tail of the game
+        m_setupInfo.keyHistory = keyHistory.last(std::min<usize>(keyHistory.size(), pos.halfmove() + 2));
+        m_setupInfo.keyHistorySize = util::pad<usize{256}>(m_setupInfo.keyHistory.size() + kMaxDepth);
 
         m_startTime = startTime;
 
@@ -165,8 +251,26 @@ namespace stormphrax::search {
 
         m_searching.store(true, std::memory_order::relaxed);
 
-        m_idleBarrier.arriveAndWait();
-        m_setupBarrier.arriveAndWait();
+        arriveAndWaitTraced(m_idleBarrier, "idle");
+        arriveAndWaitTraced(m_setupBarrier, "setup");
+    }
+
+    void Searcher::ponderhit(std::unique_ptr<limit::ISearchLimiter> limiter) {
+        // hard limits apply straight away (see checkHardTimeout),
+        // the limiter itself is swapped in between iterations
+        m_hardNodeLimit.store(limiter->hardNodeLimit(), std::memory_order::relaxed);
+
+        if (const auto deadline = limiter->hardDeadline()) {
+            m_timer.arm(*deadline);
+        }
+
+        {
+            const std::unique_lock lock{m_ponderhitMutex};
+            m_ponderhitLimiter = std::move(limiter);
+        }
+
+        m_ponderhitPending.store(true, std::memory_order::release);
+        m_pondering.store(false, std::memory_order::release);
     }
 
     void Searcher::stop() {
@@ -188,6 +292,11 @@ namespace stormphrax::search {
 
         m_multiPv = 1;
         m_infinite = false;
+        m_abdada = false;
+
+        m_hardNodeLimit.store(m_limiter->hardNodeLimit(), std::memory_order::relaxed);
+
+        m_ttable.stopScrub();
 
         m_stop.store(false, std::memory_order::seq_cst);
 
@@ -199,9 +308,17 @@ namespace stormphrax::search {
         return {whitePovScore, wdl::normalizeScore(whitePovScore, thread.rootPos.classicalMaterial())};
     }
 
-    void Searcher::runBench(BenchData& data, const Position& pos, i32 depth) {
-        m_limiter = std::make_unique<limit::InfiniteLimiter>();
+    void Searcher::runBench(BenchData& data, const Position& pos, i32 depth, std::optional<usize> maxNodes) {
+        if (maxNodes) {
+            m_limiter = std::make_unique<limit::NodeLimiter>(*maxNodes);
+        } else {
+            m_limiter = std::make_unique<limit::InfiniteLimiter>();
+        }
+
         m_infinite = false;
+        m_abdada = false;
+
+        m_hardNodeLimit.store(m_limiter->hardNodeLimit(), std::memory_order::relaxed);
 
         m_contempt = {};
 
@@ -219,6 +336,8 @@ namespace stormphrax::search {
             return;
         }
 
+        m_ttable.stopScrub();
+
         m_stop.store(false, std::memory_order::seq_cst);
 
         const auto start = Instant::now();
@@ -227,22 +346,93 @@ namespace stormphrax::search {
 
         m_ttable.age();
 
+#if SP_TT_STATS
+        // bench threads are temporary, so keep their counters around for ttstats
+        m_threads[0].ttStats += thread->ttStats;
+#endif
+
         data.search = thread->search;
         data.time = start.elapsed();
     }
 
+    void Searcher::runSilentSearch(BenchData& data, const Position& pos, i32 depth, std::optional<usize> maxNodes) {
+        m_silent = true;
+
+        const auto start = Instant::now();
+
+        std::unique_ptr<limit::ISearchLimiter> limiter{};
+
+        if (maxNodes) {
+            limiter = std::make_unique<limit::NodeLimiter>(*maxNodes);
+        } else {
+            limiter = std::make_unique<limit::InfiniteLimiter>();
+        }
+
+        startSearch(pos, {}, start, depth, {}, std::move(limiter), false, false);
+        waitForStop();
+
+        // the main thread holds the search mutex until it has finished reporting
+        while (searching()) {
+            std::this_thread::yield();
+        }
+
+        data.time = start.elapsed();
+
+        data.search = m_threads[0].search;
+        data.search.nodes.store(0);
+
+        for (const auto& thread : m_threads) {
+            data.search.nodes.fetch_add(thread.search.loadNodes());
+        }
+
+        m_silent = false;
+    }
+
     void Searcher::setThreads(u32 threadCount) {
         if (threadCount == m_threads.size()) {
             return;
         }
 
+        resizeThreads(threadCount);
+    }
+
+    void Searcher::setNumaMode(util::numa::Mode mode) {
+        const auto threadCount = static_cast<u32>(m_threads.size());
+
+        const bool numa = util::numa::enabled(mode);
+        const bool pin = util::numa::shouldPin(mode, threadCount);
+
+        m_numaMode = mode;
+
+        if (numa == m_numa && pin == m_pinThreads) {
+            return;
+        }
+
+        m_pinThreads = pin;
+
+        // recreate the threads to (un)pin them
+        createThreads(threadCount);
+
+        if (numa == m_numa) {
+            return;
+        }
+
+        m_numa = numa;
+        m_ttable.setInterleaved(numa);
+
+        if (numa) {
+            println("info string NUMA enabled, {} node(s)", util::numa::nodeCount());
+        } else {
+            println("info string NUMA disabled");
+        }
+    }
+
+    void Searcher::createThreads(u32 threadCount) {
         stopThreads();
 
         m_quit.store(false, std::memory_order::seq_cst);
 
         m_threads.clear();
-        m_threads.shrink_to_fit();
-        m_threads.reserve(threadCount);
 
         m_resetBarrier.reset(threadCount + 1);
         m_idleBarrier.reset(threadCount + 1);
@@ -258,6 +448,57 @@ namespace stormphrax::search {
         }
     }
 
+    void Searcher::resizeThreads(u32 threadCount) {
+        assert(threadCount > 0);
+
+        const auto prevCount = static_cast<u32>(m_threads.size());
+        const auto keptCount = std::min(prevCount, threadCount);
+
+        m_ttable.stopScrub();
+
+        // kept threads re-pin themselves after the resize if this changes
+        m_pinThreads = util::numa::shouldPin(m_numaMode, threadCount);
+
+        // wake the existing threads like for a search, workers past the new
+        // count exit and the rest wait on m_setupBarrier while it is resized
+        m_resetBarrier.arriveAndWait();
+
+        m_resizeTarget = threadCount;
+        m_setupBarrier.reset(keptCount + 1);
+
+        m_idleBarrier.arriveAndWait();
+
+        while (m_threads.size() > threadCount) {
+            m_threads.back().thread.join();
+
+#if SP_TT_STATS
+            // keep the counters of removed threads around for ttstats
+            m_threads[0].ttStats += m_threads.back().ttStats;
+#endif
+
+            m_threads.pop_back();
+        }
+
+        // nothing else is waiting on these until the kept threads are released
+        m_resetBarrier.reset(threadCount + 1);
+        m_idleBarrier.reset(threadCount + 1);
+        m_searchEndBarrier.reset(threadCount);
+
+        m_setupBarrier.arriveAndWait();
+
+        m_setupBarrier.reset(threadCount + 1);
+        m_resizeTarget = 0;
+
+        // std::deque never moves existing elements, so the references
+        // held by running threads stay valid
+        for (u32 threadId = prevCount; threadId < threadCount; ++threadId) {
+            auto& thread = m_threads.emplace_back();
+
+            thread.id = threadId;
+            thread.thread = std::thread{[this, &thread] { run(thread); }};
+        }
+    }
+
     RootStatus Searcher::initRootMoveList(const Position& pos) {
         m_rootMoveList.clear();
 
@@ -293,6 +534,274 @@ namespace stormphrax::search {
         return m_rootMoveList.empty() ? RootStatus::kNoLegalMoves : RootStatus::kGenerated;
     }
 
+    void Searcher::printTtStats(usize sampleClusters) {
+        const auto percent = [](u64 count, u64 total) {
+            return total == 0 ? 0.0 : static_cast<f64>(count) * 100.0 / static_cast<f64>(total);
+        };
+
+#if SP_TT_STATS
+        TtStats stats{};
+
+        for (const auto& thread : m_threads) {
+            stats += thread.ttStats;
+        }
+
+        const auto putCount = [&](TtPutResult result) {
+            return stats.puts[static_cast<i32>(result)];
+        };
+
+        const auto totalPuts = std::accumulate(stats.puts.begin(), stats.puts.end(), u64{});
+
+        println(
+            "info string probes {} hits {} ({:.2f}%) cutoff hits {} ({:.2f}% of hits)",
+            stats.probes,
+            stats.hits,
+            percent(stats.hits, stats.probes),
+            stats.cutoffHits,
+            percent(stats.cutoffHits, stats.hits)
+        );
+        println(
+            "info string puts {} empty slot {} ({:.2f}%) same key {} ({:.2f}%) other key {} ({:.2f}%) "
+            "eval only {} ({:.2f}%) skipped {} ({:.2f}%)",
+            totalPuts,
+            putCount(TtPutResult::kEmptySlot),
+            percent(putCount(TtPutResult::kEmptySlot), totalPuts),
+            putCount(TtPutResult::kSameKey),
+            percent(putCount(TtPutResult::kSameKey), totalPuts),
+            putCount(TtPutResult::kOtherKey),
+            percent(putCount(TtPutResult::kOtherKey), totalPuts),
+            putCount(TtPutResult::kEvalOnly),
+            percent(putCount(TtPutResult::kEvalOnly), totalPuts),
+            putCount(TtPutResult::kSkipped),
+            percent(putCount(TtPutResult::kSkipped), totalPuts)
+        );
+#else
+        println("info string TT counters not compiled in, build with SP_TT_STATS");
+#endif
+
+        finalizeTt();
+
+        // the scrub thread rewrites whole clusters
+        m_ttable.stopScrub();
+
+        const auto sample = m_ttable.sample(sampleClusters, util::rng::generateSingleSeed());
+
+        println(
+            "info string sampled {} clusters, {} live entries ({:.2f} per cluster)",
+            sample.clusters,
+            sample.entries,
+            sample.clusters == 0 ? 0.0 : static_cast<f64>(sample.entries) / static_cast<f64>(sample.clusters)
+        );
+
+        for (usize depth = 0; depth < sample.depths.size(); ++depth) {
+            if (const auto count = sample.depths[depth]; count > 0) {
+                println("info string depth {:>3} {:>9} ({:.2f}%)", depth, count, percent(count, sample.entries));
+            }
+        }
+
+        for (usize age = 0; age < sample.relativeAges.size(); ++age) {
+            if (const auto count = sample.relativeAges[age]; count > 0) {
+                println("info string {:>2} searches old {:>9} ({:.2f}%)", age, count, percent(count, sample.entries));
+            }
+        }
+    }
+
+    bool Searcher::saveState(const std::string& path) {
+        const auto start = Instant::now();
+
+        finalizeTt();
+
+        // otherwise clusters could be written out halfway through being scrubbed
+        m_ttable.stopScrub();
+
+        std::ofstream stream{path, std::ios::binary};
+
+        if (!stream) {
+            eprintln("failed to open state file \"{}\"", path);
+            return false;
+        }
+
+        const StateFileHeader header{
+            .magic = kStateFileMagic,
+            .version = kStateFileVersion,
+            .padding = 0,
+            .networkHash = eval::networkHash(),
+            .ttClusterCount = m_ttable.clusterCount(),
+            .ttClusterSize = static_cast<u32>(TTable::clusterSize()),
+            .threadCount = static_cast<u32>(m_threads.size()),
+            .historySize = sizeof(HistoryTables),
+            .correctionHistorySize = sizeof(CorrectionHistoryTable),
+        };
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        m_ttable.writeTo(stream);
+
+        for (const auto& thread : m_threads) {
+            stream.write(reinterpret_cast<const char*>(&thread.history), sizeof(HistoryTables));
+            stream.write(reinterpret_cast<const char*>(&thread.correctionHistory), sizeof(CorrectionHistoryTable));
+        }
+
+        if (!stream.flush()) {
+            eprintln("failed to write state file \"{}\"", path);
+            return false;
+        }
+
+        println("info string Saved search state in {} ms", static_cast<u32>(start.elapsed() * 1000.0));
+
+        return true;
+    }
+
+    bool Searcher::loadState(const std::string& path) {
+        const auto start = Instant::now();
+
+        util::MappedFile file{};
+
+        if (!file.open(path)) {
+            eprintln("failed to open state file \"{}\"", path);
+            return false;
+        }
+
+        const auto data = file.data();
+
+        StateFileHeader header{};
+
+        if (data.size() < sizeof(header)) {
+            eprintln("state file too small");
+            return false;
+        }
+
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        if (header.magic != kStateFileMagic) {
+            eprintln("invalid magic bytes in state file header");
+            return false;
+        }
+
+        if (header.version != kStateFileVersion) {
+            eprintln("unsupported state file version {} (expected: {})", header.version, kStateFileVersion);
+            return false;
+        }
+
+        if (header.networkHash != eval::networkHash()) {
+            eprintln("state file was written with a different network");
+            return false;
+        }
+
+        if (header.ttClusterCount != m_ttable.clusterCount() || header.ttClusterSize != TTable::clusterSize()) {
+            eprintln(
+                "state file TT geometry {} x {} bytes does not match current TT geometry {} x {} bytes",
+                header.ttClusterCount,
+                header.ttClusterSize,
+                m_ttable.clusterCount(),
+                TTable::clusterSize()
+            );
+            return false;
+        }
+
+        if (header.historySize != sizeof(HistoryTables)
+            || header.correctionHistorySize != sizeof(CorrectionHistoryTable))
+        {
+            eprintln("state file history table layout does not match");
+            return false;
+        }
+
+        const auto ttSize = m_ttable.persistedSize();
+        const auto threadSize = usize{header.historySize} + header.correctionHistorySize;
+
+        if (data.size() != sizeof(header) + ttSize + header.threadCount * threadSize) {
+            eprintln("state file has wrong size");
+            return false;
+        }
+
+        // every cluster is overwritten, no need to clear
+        m_ttable.allocate();
+
+        if (!m_ttable.readFrom(data.subspan(sizeof(header), ttSize))) {
+            eprintln("failed to read TT from state file");
+            return false;
+        }
+
+        const auto* histories = data.data() + sizeof(header) + ttSize;
+
+        for (usize i = 0; i < m_threads.size(); ++i) {
+            auto& thread = m_threads[i];
+
+            if (i >= header.threadCount) {
+                thread.history.clear();
+                thread.correctionHistory.clear();
+                continue;
+            }
+
+            const auto* threadData = histories + i * threadSize;
+
+            std::memcpy(&thread.history, threadData, sizeof(HistoryTables));
+            std::memcpy(&thread.correctionHistory, threadData + sizeof(HistoryTables), sizeof(CorrectionHistoryTable));
+        }
+
+        if (header.threadCount != m_threads.size()) {
+            println(
+                "info string State file has histories for {} threads, running {}",
+                header.threadCount,
+                m_threads.size()
+            );
+        }
+
+        println("info string Loaded search state in {} ms", static_cast<u32>(start.elapsed() * 1000.0));
+
+        return true;
+    }
+
+    bool Searcher::finalizeTt() {
+        if (!m_numa) {
+            return m_ttable.finalize();
+        }
+
+        if (!m_ttable.allocate()) {
+            return false;
+        }
+
+        clearTtOnThreads();
+        m_ttable.reportHugePages();
+
+        return true;
+    }
+
+    void Searcher::clearTt() {
+        const tracer::Span span{tracer::Event::kTtClear, "epoch"};
+
+        // O(1), unless the epoch counter has wrapped
+        if (m_ttable.advanceEpoch()) {
+            if (g_opts.hashScrub) {
+                m_ttable.startScrub();
+            }
+
+            return;
+        }
+
+        if (m_numa) {
+            clearTtOnThreads();
+        } else {
+            const tracer::Span clearSpan{tracer::Event::kTtClear, "full"};
+            m_ttable.clear();
+        }
+    }
+
+    void Searcher::clearTtOnThreads() {
+        const tracer::Span span{tracer::Event::kTtClear, "threads"};
+
+        m_ttable.stopScrub();
+
+        m_resetBarrier.arriveAndWait();
+
+        m_clearingTt = true;
+
+        m_idleBarrier.arriveAndWait();
+        m_setupBarrier.arriveAndWait();
+
+        m_clearingTt = false;
+    }
+
     void Searcher::stopThreads() {
         m_quit.store(true, std::memory_order::release);
 
@@ -304,15 +813,65 @@ namespace stormphrax::search {
         }
     }
 
+    bool Searcher::updateThreadBinding(const ThreadData& thread, bool pinned) {
+        if (m_pinThreads) {
+            if (!util::numa::bindThisThread(util::numa::nodeForThread(thread.id))) {
+                println("info string Failed to pin thread {} to NUMA node", thread.id);
+                return false;
+            }
+
+            return true;
+        }
+
+        if (pinned) {
+            util::numa::unbindThisThread();
+        }
+
+        return false;
+    }
+
     void Searcher::run(ThreadData& thread) {
+        bool pinned = updateThreadBinding(thread, false);
+
+        tracer::setThreadName(fmt::format("search {}", thread.id));
+
         while (true) {
-            m_resetBarrier.arriveAndWait();
-            m_idleBarrier.arriveAndWait();
+            {
+                // between searches, so usually long and uninteresting
+                const tracer::Span span{tracer::Event::kBarrierWait, "idle"};
+
+                m_resetBarrier.arriveAndWait();
+                m_idleBarrier.arriveAndWait();
+            }
 
             if (m_quit.load(std::memory_order::acquire)) {
                 return;
             }
 
+            if (m_resizeTarget > 0) {
+                if (thread.id >= m_resizeTarget) {
+                    return;
+                }
+
+                m_setupBarrier.arriveAndWait();
+
+                if (m_pinThreads != pinned) {
+                    pinned = updateThreadBinding(thread, pinned);
+                }
+
+                continue;
+            }
+
+            if (m_clearingTt) {
+                {
+                    const tracer::Span span{tracer::Event::kTtClear, "chunk"};
+                    m_ttable.clearChunk(thread.id, m_threads.size());
+                }
+
+                arriveAndWaitTraced(m_setupBarrier, "setup");
+                continue;
+            }
+
             searchRoot(thread, true);
         }
     }
@@ -328,8 +887,9 @@ namespace stormphrax::search {
             std::ranges::copy(m_setupInfo.keyHistory, std::back_inserter(thread.keyHistory));
 
             thread.nnueState.reset(thread.rootPos.bbs(), thread.rootPos.kings());
+            thread.evalCache.syncNetwork(eval::networkGeneration());
 
-            m_setupBarrier.arriveAndWait();
+            arriveAndWaitTraced(m_setupBarrier, "setup");
         }
 
         assert(!m_rootMoveList.empty());
@@ -353,11 +913,17 @@ namespace stormphrax::search {
         searchData.nodes = 0;
         thread.stack[0].killers.clear();
 
+        if (actualSearch) {
+            thread.startLatency = elapsed();
+        }
+
         i32 depthCompleted{};
 
         for (i32 depth = 1;; ++depth) {
             searchData.rootDepth = depth;
 
+            tracer::Span iterationSpan{tracer::Event::kIteration, nullptr, depth};
+
             for (thread.pvIdx = 0; thread.pvIdx < m_multiPv; ++thread.pvIdx) {
                 searchData.seldepth = 0;
 
@@ -400,11 +966,15 @@ namespace stormphrax::search {
                     }
 
                     if (newScore <= alpha) {
+                        tracer::instant(tracer::Event::kAspFailLow, depth, alpha, beta, newScore);
+
                         aspReduction = 0;
 
                         beta = (alpha + beta) / 2;
                         alpha = std::max(newScore - delta, -kScoreInf);
                     } else {
+                        tracer::instant(tracer::Event::kAspFailHigh, depth, alpha, beta, newScore);
+
                         aspReduction = std::min(aspReduction + 1, 3);
                         beta = std::min(newScore + delta, kScoreInf);
                     }
@@ -423,20 +993,30 @@ namespace stormphrax::search {
                 }
             }
 
+            iterationSpan.setArg(1, thread.pvMove().score);
+
             if (hasStopped()) {
                 break;
             }
 
             depthCompleted = depth;
+            iterationSpan.setArg(2, 1);
 
             if (depth >= m_maxDepth) {
-                if (mainThread && m_infinite) {
+                if (mainThread && (m_infinite || m_pondering.load(std::memory_order::relaxed))) {
                     report(thread, searchData.rootDepth, elapsed());
                 }
                 break;
             }
 
             if (mainThread) {
+                if (m_ponderhitPending.load(std::memory_order::acquire)) {
+                    const std::unique_lock lock{m_ponderhitMutex};
+
+                    m_limiter = std::move(m_ponderhitLimiter);
+                    m_ponderhitPending.store(false, std::memory_order::relaxed);
+                }
+
                 m_limiter->update(
                     thread.search,
                     thread.pvMove().score,
@@ -444,6 +1024,13 @@ namespace stormphrax::search {
                     thread.search.loadNodes()
                 );
 
+                // always finish depth 1, so that there is a searched move to play
+                if (depth == 1) {
+                    if (const auto deadline = m_limiter->hardDeadline()) {
+                        m_timer.arm(*deadline);
+                    }
+                }
+
                 if (checkSoftTimeout(thread.search, true)) {
                     break;
                 }
@@ -461,22 +1048,24 @@ namespace stormphrax::search {
                 m_stopSignal.notify_all();
             }
 
-            m_searchEndBarrier.arriveAndWait();
+            arriveAndWaitTraced(m_searchEndBarrier, "search end");
         };
 
         if (mainThread) {
             auto time = elapsed();
 
-            if (m_infinite) {
-                // don't print bestmove until stopped when go infinite'ing
-                // this makes handling reports a bit messy, unfortunately
-                while (!hasStopped()) {
-                    std::this_thread::yield();
-                }
+            // don't print bestmove until stopped when go infinite'ing, or until
+            // ponderhit or stop when pondering. this makes handling reports
+            // a bit messy, unfortunately
+            while ((m_infinite || m_pondering.load(std::memory_order::acquire)) && !hasStopped()) {
+                std::this_thread::yield();
             }
 
             const std::unique_lock lock{m_searchMutex};
 
+            m_timer.disarm();
+
+            m_pondering.store(false, std::memory_order::relaxed);
             m_stop.store(true, std::memory_order::seq_cst);
             waitForThreads();
 
@@ -484,13 +1073,17 @@ namespace stormphrax::search {
                 time = elapsed();
             }
 
+            if (g_opts.showStartLatency && !m_silent) {
+                reportStartLatency();
+            }
+
             finalReport(thread, depthCompleted, time);
 
             m_ttable.age();
             stats::print();
 
             m_searching.store(false, std::memory_order::relaxed);
-        } else {
+        } else if (actualSearch) {
             waitForThreads();
         }
 
@@ -572,7 +1165,7 @@ namespace stormphrax::search {
         bool ttHit = false;
 
         if (!curr.excluded) {
-            ttHit = m_ttable.probe(ttEntry, pos.key(), ply);
+            ttHit = probeTt(thread, ttEntry, pos.key(), ply);
 
             if (!kPvNode && ttEntry.depth >= depth && (ttEntry.score <= alpha || cutnode)) {
                 if (ttEntry.flag == TtFlag::kExact                                   //
@@ -593,6 +1186,12 @@ namespace stormphrax::search {
                         );
                     }
 
+#if SP_TT_STATS
+                    ++thread.ttStats.cutoffHits;
+#endif
+
+                    s_ttCutoffs.inc(depth);
+
                     return ttEntry.score;
                 } else if (depth <= 6) {
                     ++depth;
@@ -642,7 +1241,7 @@ namespace stormphrax::search {
                     || flag == TtFlag::kUpperBound && score <= alpha //
                     || flag == TtFlag::kLowerBound && score >= beta)
                 {
-                    m_ttable.put(pos.key(), score, kScoreNone, kNullMove, depth, ply, flag, ttpv);
+                    putTt(thread, pos.key(), score, kScoreNone, kNullMove, depth, ply, flag, ttpv);
                     return score;
                 }
 
@@ -672,11 +1271,11 @@ namespace stormphrax::search {
             } else if (ttHit && ttEntry.staticEval != kScoreNone) {
                 rawStaticEval = ttEntry.staticEval;
             } else {
-                rawStaticEval = eval::staticEval(pos, thread.nnueState, m_contempt);
+                rawStaticEval = eval::staticEval(pos, thread.nnueState, thread.evalCache, m_contempt);
             }
 
-            if (!ttHit) {
-                m_ttable.put(pos.key(), kScoreNone, rawStaticEval, kNullMove, 0, 0, TtFlag::kNone, ttpv);
+            if (!ttHit && g_opts.ttEvalWrites) {
+                putTt(thread, pos.key(), kScoreNone, rawStaticEval, kNullMove, 0, 0, TtFlag::kNone, ttpv);
             }
 
             if (inCheck) {
@@ -712,12 +1311,14 @@ namespace stormphrax::search {
             };
 
             if (depth <= 6 && curr.staticEval - rfpMargin() >= beta) {
+                s_rfpCutoffs.inc(depth);
                 return !isWin(curr.staticEval) && !isWin(beta) ? (curr.staticEval + beta) / 2 : curr.staticEval;
             }
 
             if (depth <= 4 && std::abs(alpha) < 2000 && curr.staticEval + razoringMargin() * depth <= alpha) {
                 const auto score = qsearch(thread, pos, ply, moveStackIdx, alpha, alpha + 1);
                 if (score <= alpha) {
+                    s_razoringCutoffs.inc(depth);
                     return score;
                 }
             }
@@ -727,6 +1328,8 @@ namespace stormphrax::search {
             {
                 m_ttable.prefetch(pos.key() ^ keys::color());
 
+                s_nmpSearches.inc(depth);
+
                 const auto R =
                     4 + depth / 5 + std::min((curr.staticEval - beta) / nmpEvalReductionScale(), 2) + improving;
 
@@ -747,9 +1350,12 @@ namespace stormphrax::search {
 
                 if (score >= beta) {
                     if (depth <= 14 || thread.minNmpPly > 0) {
+                        s_nmpCutoffs.inc(depth);
                         return score > kScoreWin ? beta : score;
                     }
 
+                    s_nmpVerifications.inc(depth);
+
                     thread.minNmpPly = ply + (depth - R) * 3 / 4;
 
                     const auto verifScore =
@@ -758,6 +1364,7 @@ namespace stormphrax::search {
                     thread.minNmpPly = 0;
 
                     if (verifScore >= beta) {
+                        s_nmpVerifiedCutoffs.inc(depth);
                         return verifScore;
                     }
                 }
@@ -809,7 +1416,8 @@ namespace stormphrax::search {
                     }
 
                     if (score >= probcutBeta) {
-                        m_ttable.put(
+                        putTt(
+                            thread,
                             pos.key(),
                             score,
                             curr.staticEval,
@@ -819,6 +1427,7 @@ namespace stormphrax::search {
                             TtFlag::kLowerBound,
                             false
                         );
+                        s_probcutCutoffs.inc(depth);
                         return score;
                     }
                 }
@@ -840,12 +1449,31 @@ namespace stormphrax::search {
 
         u32 legalMoves = 0;
 
-        while (const auto move = generator.next()) {
-            if (move == curr.excluded) {
-                continue;
-            }
+        auto* abdadaTable = !kRootNode && m_abdada && !curr.excluded && depth >= kAbdadaMinDepth
+                              ? m_abdadaTable.get()
+                              : nullptr;
 
-            if constexpr (kRootNode) {
+        auto& deferredMoves = moveStack.deferredMoves;
+        usize deferredIdx = 0;
+
+        deferredMoves.clear();
+
+        while (true) {
+            auto move = generator.next();
+            bool deferred = false;
+
+            // moves deferred by ABDADA have already passed the checks
+            // and pruning below, so search them straight away
+            if (!move) {
+                if (deferredIdx == deferredMoves.size()) {
+                    break;
+                }
+
+                move = deferredMoves[deferredIdx++].move;
+                deferred = true;
+            } else if (move == curr.excluded) {
+                continue;
+            } else if constexpr (kRootNode) {
                 if (!thread.isLegalRootMove(move)) {
                     continue;
                 }
@@ -855,7 +1483,8 @@ namespace stormphrax::search {
                 continue;
             }
 
-            const bool quietOrLosing = generator.stage() > MovegenStage::kGoodNoisy;
+            const bool quietOrLosing = deferred ? deferredMoves[deferredIdx - 1].quietOrLosing
+                                                : generator.stage() > MovegenStage::kGoodNoisy;
 
             const bool noisy = pos.isNoisy(move);
             const auto moving = boards.pieceOn(move.fromSq());
@@ -867,17 +1496,20 @@ namespace stormphrax::search {
             const auto history = noisy ? thread.history.noisyScore(move, captured, pos.threats())
                                        : thread.history.quietScore(thread.conthist, ply, pos.threats(), moving, move);
 
-            if ((!kRootNode || thread.search.rootDepth == 1) && bestScore > -kScoreWin && (!kPvNode || !thread.datagen))
+            if ((!kRootNode || thread.search.rootDepth == 1) && !deferred && bestScore > -kScoreWin
+                && (!kPvNode || !thread.datagen))
             {
                 const auto lmrDepth = std::max(depth - baseLmr / 128, 0);
 
                 if (!noisy) {
                     if (legalMoves >= kLmpTable[improving][std::min(depth, 15)]) {
+                        s_lmpPrunes.inc(depth);
                         generator.skipQuiets();
                         continue;
                     }
 
                     if (lmrDepth <= 5 && history < quietHistPruningMargin() * depth + quietHistPruningOffset()) {
+                        s_quietHistPrunes.inc(depth);
                         generator.skipQuiets();
                         continue;
                     }
@@ -885,11 +1517,13 @@ namespace stormphrax::search {
                     if (!inCheck && lmrDepth <= 8 && std::abs(alpha) < 2000
                         && curr.staticEval + fpMargin() + depth * fpScale() <= alpha)
                     {
+                        s_futilityPrunes.inc(depth);
                         generator.skipQuiets();
                         continue;
                     }
                 } else if (depth <= 4 && history < noisyHistPruningMargin() * depth * depth + noisyHistPruningOffset())
                 {
+                    s_noisyHistPrunes.inc(depth);
                     continue;
                 }
 
@@ -897,10 +1531,19 @@ namespace stormphrax::search {
                     noisy ? seePruningThresholdNoisy() * depth : seePruningThresholdQuiet() * lmrDepth * lmrDepth;
 
                 if (quietOrLosing && !see::see(pos, move, seeThreshold)) {
+                    s_seePrunes.inc(depth);
                     continue;
                 }
             }
 
+            const auto abdadaKey = abdadaTable ? AbdadaTable::moveKey(pos.key(), move) : 0;
+
+            // another thread is already searching this move, come back to it later
+            if (abdadaTable && !deferred && legalMoves > 0 && abdadaTable->busy(abdadaKey)) {
+                deferredMoves.push({move, quietOrLosing});
+                continue;
+            }
+
             if constexpr (kPvNode) {
                 curr.pv.length = 0;
             }
@@ -923,6 +1566,8 @@ namespace stormphrax::search {
                     const auto sBeta = ttEntry.score - depth * sBetaMargin() / 16;
                     const auto sDepth = (depth - 1) / 2;
 
+                    s_singularSearches.inc(depth);
+
                     curr.excluded = move;
 
                     const auto score =
@@ -937,15 +1582,27 @@ namespace stormphrax::search {
                             extension = 1;
                         }
                     } else if (sBeta >= beta) {
+                        s_multicutCutoffs.inc(depth);
                         return sBeta;
                     } else if (cutnode) {
                         extension = -2;
                     } else if (ttEntry.score >= beta) {
                         extension = -1;
                     }
+
+                    if (extension == 1) {
+                        s_singularExtensions.inc(depth);
+                    } else if (extension == 2) {
+                        s_doubleExtensions.inc(depth);
+                    } else if (extension == 3) {
+                        s_tripleExtensions.inc(depth);
+                    } else if (extension < 0) {
+                        s_negativeExtensions.inc(depth);
+                    }
                 } else if (depth <= 7 && !inCheck && curr.staticEval <= alpha - ldseMargin()
                            && ttEntry.flag == TtFlag::kLowerBound)
                 {
+                    s_ldseExtensions.inc(depth);
                     extension = 1;
                 }
             }
@@ -954,6 +1611,7 @@ namespace stormphrax::search {
 
             m_ttable.prefetch(pos.roughKeyAfter(move));
 
+            const AbdadaGuard abdadaGuard{abdadaTable, abdadaKey};
             const auto [newPos, guard] = thread.applyMove(pos, ply, move);
 
             const bool givesCheck = newPos.isCheck();
@@ -985,6 +1643,9 @@ namespace stormphrax::search {
 
                     // can't use std::clamp because newDepth can be <0
                     const auto reduced = std::min(std::max(newDepth - r, 1), newDepth);
+
+                    s_lmrSearches.inc(depth);
+
                     score =
                         -search(thread, newPos, curr.pv, reduced, ply + 1, moveStackIdx + 1, -alpha - 1, -alpha, true);
 
@@ -994,6 +1655,8 @@ namespace stormphrax::search {
 
                         newDepth += doDeeperSearch - doShallowerSearch;
 
+                        s_lmrResearches.inc(depth);
+
                         score = -search(
                             thread,
                             newPos,
@@ -1035,6 +1698,10 @@ namespace stormphrax::search {
                 //   - alpha was raised by a previous zero-window search,
                 // then do a full-window search to get the true score of this node
                 if (kPvNode && (legalMoves == 1 || score > alpha)) {
+                    if (legalMoves > 1) {
+                        s_pvsResearches.inc(depth);
+                    }
+
                     score = -search<
                         true>(thread, newPos, curr.pv, newDepth, ply + 1, moveStackIdx + 1, -beta, -alpha, false);
                 }
@@ -1168,7 +1835,7 @@ namespace stormphrax::search {
             }
 
             if (!kRootNode || thread.pvIdx == 0) {
-                m_ttable.put(pos.key(), bestScore, rawStaticEval, bestMove, depth, ply, ttFlag, ttpv);
+                putTt(thread, pos.key(), bestScore, rawStaticEval, bestMove, depth, ply, ttFlag, ttpv);
             }
         }
 
@@ -1218,13 +1885,19 @@ namespace stormphrax::search {
         }
 
         ProbedTTableEntry ttEntry{};
-        const bool ttHit = m_ttable.probe(ttEntry, pos.key(), ply);
+        const bool ttHit = probeTt(thread, ttEntry, pos.key(), ply);
 
         if (!kPvNode
             && (ttEntry.flag == TtFlag::kExact                                   //
                 || ttEntry.flag == TtFlag::kUpperBound && ttEntry.score <= alpha //
                 || ttEntry.flag == TtFlag::kLowerBound && ttEntry.score >= beta))
         {
+#if SP_TT_STATS
+            ++thread.ttStats.cutoffHits;
+#endif
+
+            s_ttCutoffs.inc(0);
+
             return ttEntry.score;
         }
 
@@ -1239,11 +1912,11 @@ namespace stormphrax::search {
             if (ttHit && ttEntry.staticEval != kScoreNone) {
                 rawStaticEval = ttEntry.staticEval;
             } else {
-                rawStaticEval = eval::staticEval(pos, thread.nnueState, m_contempt);
+                rawStaticEval = eval::staticEval(pos, thread.nnueState, thread.evalCache, m_contempt);
             }
 
-            if (!ttHit) {
-                m_ttable.put(pos.key(), kScoreNone, rawStaticEval, kNullMove, 0, 0, TtFlag::kNone, ttpv);
+            if (!ttHit && g_opts.ttEvalWrites) {
+                putTt(thread, pos.key(), kScoreNone, rawStaticEval, kNullMove, 0, 0, TtFlag::kNone, ttpv);
             }
 
             const auto staticEval =
@@ -1259,6 +1932,7 @@ namespace stormphrax::search {
             }
 
             if (eval >= beta) {
+                s_standPatCutoffs.inc(0);
                 return !isWin(eval) && !isWin(beta) ? (eval + beta) / 2 : eval;
             }
 
@@ -1292,6 +1966,8 @@ namespace stormphrax::search {
 
             if (bestScore > -kScoreWin) {
                 if (!inCheck && futility <= alpha && !see::see(pos, move, 1)) {
+                    s_futilityPrunes.inc(0);
+
                     if (bestScore < futility) {
                         bestScore = futility;
                     }
@@ -1299,10 +1975,12 @@ namespace stormphrax::search {
                 }
 
                 if (legalMoves >= 2) {
+                    s_lmpPrunes.inc(0);
                     break;
                 }
 
                 if (!see::see(pos, move, qsearchSeeThreshold())) {
+                    s_seePrunes.inc(0);
                     continue;
                 }
             }
@@ -1349,12 +2027,16 @@ namespace stormphrax::search {
             return -kScoreMate + ply;
         }
 
-        m_ttable.put(pos.key(), bestScore, rawStaticEval, bestMove, 0, ply, ttFlag, ttpv);
+        putTt(thread, pos.key(), bestScore, rawStaticEval, bestMove, 0, ply, ttFlag, ttpv);
 
         return bestScore;
     }
 
     void Searcher::reportSingle(const ThreadData& mainThread, u32 pvIdx, i32 depth, f64 time) {
+        if (m_silent) {
+            return;
+        }
+
         const auto& move = mainThread.rootMoves[pvIdx];
 
         auto score = move.score == -kScoreInf ? move.displayScore : move.score;
@@ -1447,6 +2129,31 @@ namespace stormphrax::search {
         println();
     }
 
+    void Searcher::reportStartLatency() {
+        auto min = std::numeric_limits<f64>::max();
+        f64 max{};
+        f64 total{};
+
+        std::string latencies{};
+        auto latencyItr = std::back_inserter(latencies);
+
+        for (const auto& thread : m_threads) {
+            min = std::min(min, thread.startLatency);
+            max = std::max(max, thread.startLatency);
+            total += thread.startLatency;
+
+            fmt::format_to(latencyItr, " {:.0f}", thread.startLatency * 1000000.0);
+        }
+
+        println(
+            "info string go to first node latency us min {:.0f} mean {:.0f} max {:.0f} threads{}",
+            min * 1000000.0,
+            total / static_cast<f64>(m_threads.size()) * 1000000.0,
+            max * 1000000.0,
+            latencies
+        );
+    }
+
     void Searcher::report(const ThreadData& mainThread, i32 depth, f64 time) {
         for (u32 pvIdx = 0; pvIdx < m_multiPv; ++pvIdx) {
             reportSingle(mainThread, pvIdx, depth, time);
@@ -1454,7 +2161,18 @@ namespace stormphrax::search {
     }
 
     void Searcher::finalReport(const ThreadData& mainThread, i32 depthCompleted, f64 time) {
+        if (m_silent) {
+            return;
+        }
+
         report(mainThread, depthCompleted, time);
-        println("bestmove {}", mainThread.pvMove().pv.moves[0]);
+
+        const auto& pv = mainThread.pvMove().pv;
+
+        if (g_opts.ponder && pv.length > 1) {
+            println("bestmove {} ponder {}", pv.moves[0], pv.moves[1]);
+        } else {
+            println("bestmove {}", pv.moves[0]);
+        }
     }
 } // namespace stormphrax::search
@@ -24,6 +24,7 @@
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <limits>
 #include <memory>
 #include <mutex>
@@ -34,6 +35,7 @@
 #include <utility>
 #include <vector>
 
+#include "abdada.h"
 #include "correction.h"
 #include "eval/eval.h"
 #include "history.h"
@@ -43,6 +45,8 @@
 #include "search_fwd.h"
 #include "ttable.h"
 #include "util/barrier.h"
+#include "util/deadline_timer.h"
+#include "util/numa.h"
 #include "util/timer.h"
 
 namespace stormphrax::search {
@@ -93,10 +97,16 @@ namespace stormphrax::search {
         Move excluded{};
     };
 
+    struct DeferredMove {
+        Move move;
+        bool quietOrLosing;
+    };
+
     struct MoveStackEntry {
         MovegenData movegenData{};
         StaticVector<Move, 256> failLowQuiets{};
         StaticVector<Move, 32> failLowNoisies{};
+        StaticVector<DeferredMove, 256> deferredMoves{};
     };
 
     struct RootMove {
@@ -152,6 +162,7 @@ namespace stormphrax::search {
         i32 minNmpPly{};
 
         eval::NnueState nnueState{};
+        eval::EvalCache evalCache{};
 
         u32 pvIdx{};
         std::vector<RootMove> rootMoves{};
@@ -164,10 +175,17 @@ namespace stormphrax::search {
         HistoryTables history{};
         CorrectionHistoryTable correctionHistory{};
 
+#if SP_TT_STATS
+        TtStats ttStats{};
+#endif
+
         Position rootPos{};
 
         std::vector<u64> keyHistory{};
 
+        // seconds from go until this thread started searching
+        f64 startLatency{};
+
         [[nodiscard]] inline bool isMainThread() const {
             return id == 0;
         }
@@ -283,26 +301,54 @@ namespace stormphrax::search {
             i32 maxDepth,
             std::span<Move> moves,
             std::unique_ptr<limit::ISearchLimiter> limiter,
-            bool infinite
+            bool infinite,
+            bool ponder
         );
 
+        // Switches a go ponder search over to the given limiter without restarting it
+        void ponderhit(std::unique_ptr<limit::ISearchLimiter> limiter);
+
         void stop();
         void waitForStop();
 
         // -> [move, unnormalised, normalised]
         std::pair<Score, Score> runDatagenSearch(ThreadData& thread);
 
-        void runBench(BenchData& data, const Position& pos, i32 depth);
+        // maxNodes, if set, also stops the search after that many nodes (soft if softNodes is enabled)
+        void runBench(BenchData& data, const Position& pos, i32 depth, std::optional<usize> maxNodes = {});
+
+        // Full search on the search threads to a fixed depth or node count, without
+        // printing info or bestmove. Blocks until finished, nodes are summed over threads
+        void runSilentSearch(BenchData& data, const Position& pos, i32 depth, std::optional<usize> maxNodes = {});
 
         [[nodiscard]] inline bool searching() const {
             const std::unique_lock lock{m_searchMutex};
             return m_searching.load(std::memory_order::relaxed);
         }
 
+        [[nodiscard]] inline bool pondering() const {
+            const std::unique_lock lock{m_searchMutex};
+            return m_searching.load(std::memory_order::relaxed) && m_pondering.load(std::memory_order::relaxed);
+        }
+
         void setThreads(u32 threadCount);
+        void setNumaMode(util::numa::Mode mode);
+
+        // Prints TT counters summed over all threads (SP_TT_STATS builds only),
+        // and depth/age histograms of a random sample of TT clusters
+        void printTtStats(usize sampleClusters);
+
+        // Persists the TT and every thread's history tables, for warm starts
+        bool saveState(const std::string& path);
+        // Only accepts files written with the same network and TT size
+        bool loadState(const std::string& path);
 
         inline void setTtSize(usize mib) {
-            m_ttable.resize(mib);
+            if (g_opts.preserveHashOnResize) {
+                m_ttable.resizePreserving(mib);
+            } else {
+                m_ttable.resize(mib);
+            }
         }
 
         inline void quit() {
@@ -315,7 +361,27 @@ namespace stormphrax::search {
     private:
         TTable m_ttable;
 
-        std::vector<ThreadData> m_threads{};
+        // deque for reference stability when resizing
+        std::deque<ThreadData> m_threads{};
+
+        util::numa::Mode m_numaMode{util::numa::Mode::kAuto};
+        // interleave the TT and clear it on the search threads
+        bool m_numa{};
+        // pin search threads to NUMA nodes, depends on the thread count in auto mode
+        bool m_pinThreads{};
+        // set while waking the search threads to clear the TT instead of searching
+        bool m_clearingTt{};
+        // set while waking the search threads to grow or shrink the pool,
+        // threads with an id past this exit
+        u32 m_resizeTarget{};
+
+        // defer moves being searched by other threads, see abdada.h.
+        // allocated on first use
+        bool m_abdada{};
+        std::unique_ptr<AbdadaTable> m_abdadaTable{};
+
+        // suppress info and bestmove output
+        bool m_silent{};
 
         mutable std::mutex m_searchMutex{};
 
@@ -337,6 +403,19 @@ namespace stormphrax::search {
         std::atomic_int m_runningThreads{};
 
         std::unique_ptr<limit::ISearchLimiter> m_limiter{};
+        // cached from m_limiter at the start of each search, or on ponderhit
+        std::atomic<usize> m_hardNodeLimit{std::numeric_limits<usize>::max()};
+
+        // while set, the search does not stop by itself
+        std::atomic_bool m_pondering{};
+
+        // handed over to the main thread at the next iteration boundary
+        std::mutex m_ponderhitMutex{};
+        std::unique_ptr<limit::ISearchLimiter> m_ponderhitLimiter{};
+        std::atomic_bool m_ponderhitPending{};
+
+        // sets m_stop once the limiter's hard deadline passes
+        util::DeadlineTimer m_timer{[this] { m_stop.store(1, std::memory_order::relaxed); }};
 
         bool m_infinite{};
         i32 m_maxDepth{kMaxDepth};
@@ -354,20 +433,36 @@ namespace stormphrax::search {
 
         RootStatus initRootMoveList(const Position& pos);
 
+        bool finalizeTt();
+        void clearTt();
+        void clearTtOnThreads();
+
+        // recreates every thread from scratch
+        void createThreads(u32 threadCount);
+        // keeps existing threads and their allocations
+        void resizeThreads(u32 threadCount);
         void stopThreads();
 
         void run(ThreadData& thread);
+        // (un)pins the calling search thread to match m_pinThreads, returns whether it is now pinned
+        bool updateThreadBinding(const ThreadData& thread, bool pinned);
 
         [[nodiscard]] inline bool hasStopped() const {
             return m_stop.load(std::memory_order::relaxed) != 0;
         }
 
-        [[nodiscard]] inline bool checkStop(const SearchData& data, bool mainThread, bool allowSoft) {
+        // called at every node - hard time limits are enforced by m_timer,
+        // so only the main thread's node count needs checking here
+        [[nodiscard]] inline bool checkHardTimeout(const SearchData& data, bool mainThread) {
             if (hasStopped()) {
                 return true;
             }
 
-            if (mainThread && m_limiter->stop(data, allowSoft)) {
+            // until the next iteration boundary, m_limiter is still the pondering
+            // limiter after a ponderhit, so the new node limit is enforced on its own
+            if (mainThread && data.loadNodes() >= m_hardNodeLimit.load(std::memory_order::relaxed)
+                && (m_ponderhitPending.load(std::memory_order::acquire) || m_limiter->stop(data, false)))
+            {
                 m_stop.store(1, std::memory_order::relaxed);
                 return true;
             }
@@ -375,18 +470,52 @@ namespace stormphrax::search {
             return false;
         }
 
-        [[nodiscard]] inline bool checkHardTimeout(const SearchData& data, bool mainThread) {
-            return checkStop(data, mainThread, false);
-        }
-
         [[nodiscard]] inline bool checkSoftTimeout(const SearchData& data, bool mainThread) {
-            return checkStop(data, mainThread, true);
+            if (hasStopped()) {
+                return true;
+            }
+
+            if (mainThread && m_limiter->stop(data, true)) {
+                m_stop.store(1, std::memory_order::relaxed);
+                return true;
+            }
+
+            return false;
         }
 
         [[nodiscard]] inline f64 elapsed() const {
             return m_startTime.elapsed();
         }
 
+        inline bool probeTt([[maybe_unused]] ThreadData& thread, ProbedTTableEntry& dst, u64 key, i32 ply) {
+            const bool hit = m_ttable.probe(dst, key, ply);
+
+#if SP_TT_STATS
+            ++thread.ttStats.probes;
+            thread.ttStats.hits += hit;
+#endif
+
+            return hit;
+        }
+
+        inline void putTt(
+            [[maybe_unused]] ThreadData& thread,
+            u64 key,
+            Score score,
+            Score staticEval,
+            Move move,
+            i32 depth,
+            i32 ply,
+            TtFlag flag,
+            bool pv
+        ) {
+            [[maybe_unused]] const auto result = m_ttable.put(key, score, staticEval, move, depth, ply, flag, pv);
+
+#if SP_TT_STATS
+            thread.ttStats.recordPut(result);
+#endif
+        }
+
         Score searchRoot(ThreadData& thread, bool actualSearch);
 
         template <bool kPvNode = false, bool kRootNode = false>
@@ -420,6 +549,8 @@ namespace stormphrax::search {
 
         void reportSingle(const ThreadData& mainThread, u32 pvIdx, i32 depth, f64 time);
 
+        void reportStartLatency();
+
         void report(const ThreadData& mainThread, i32 depth, f64 time);
         void finalReport(const ThreadData& mainThread, i32 depthCompleted, f64 time);
     };
@@ -25,6 +25,7 @@
 #include "attacks/attacks.h"
 #include "core.h"
 #include "position/position.h"
+#include "profiler.h"
 #include "rays.h"
 #include "tunable.h"
 
@@ -76,6 +77,8 @@ namespace stormphrax::see {
 
     // basically ported from ethereal and weiss (their implementation is the same)
     inline bool see(const Position& pos, Move move, Score threshold) {
+        const profiler::ScopedTimer timer{profiler::Component::kSee};
+
         const auto& boards = pos.boards();
         const auto& bbs = boards.bbs();
 
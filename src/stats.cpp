@@ -15,130 +15,189 @@
  * You should have received a copy of the GNU General Public License
  * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
  */
-
 #include "stats.h"
 
-#include <atomic>
 #include <limits>
-#include <utility>
-
-#include "util/multi_array.h"
+#include <string>
+#include <vector>
 
 namespace stormphrax::stats {
     namespace {
-        constexpr usize kSlots = 32;
-
-        struct Range {
-            std::atomic<i64> min{std::numeric_limits<i64>::max()};
-            std::atomic<i64> max{std::numeric_limits<i64>::min()};
+        struct StatInfo {
+            std::string name;
+            Kind kind;
+            u32 slot;
+            u32 slotCount;
         };
 
-        util::MultiArray<std::atomic<u64>, kSlots, 2> s_conditionHits{};
-        util::MultiArray<Range, kSlots> s_ranges{};
-        util::MultiArray<std::pair<std::atomic<i64>, std::atomic<u64>>, kSlots> s_means{};
+        std::vector<StatInfo>& registry() {
+            static std::vector<StatInfo> stats{};
+            return stats;
+        }
 
-        std::atomic_bool s_anyUsed{false};
+        u32 s_usedSlots{};
 
-        template <typename T>
-        inline void atomicMin(std::atomic<T>& v, T x) {
-            auto curr = v.load();
-            while (x < curr && v.compare_exchange_weak(curr, x)) {
-                //
-            }
-        }
+        [[nodiscard]] std::vector<u64> mergeShards() {
+            std::vector<u64> totals(s_usedSlots);
 
-        template <typename T>
-        inline void atomicMax(std::atomic<T>& v, T x) {
-            auto curr = v.load();
-            while (x > curr && v.compare_exchange_weak(curr, x)) {
-                //
-            }
-        }
-    } // namespace
+            detail::Shards::forEach([&](const detail::Shard& shard) {
+                for (u32 slot = 0; slot < s_usedSlots; ++slot) {
+                    totals[slot] += shard.slots[slot].load(std::memory_order::relaxed);
+                }
+            });
 
-    void conditionHit(bool condition, usize slot) {
-        if (slot >= kSlots) {
-            eprintln("tried to hit condition {} (max {})", slot, kSlots - 1);
-            return;
+            return totals;
         }
 
-        ++s_conditionHits[slot][condition];
+        void printRange(const StatInfo& stat) {
+            bool any = false;
 
-        s_anyUsed = true;
-    }
+            i64 min = std::numeric_limits<i64>::max();
+            i64 max = std::numeric_limits<i64>::min();
 
-    void range(i64 v, usize slot) {
-        if (slot >= kSlots) {
-            eprintln("tried to hit range {} (max {})", slot, kSlots - 1);
-            return;
-        }
+            // min and max don't sum, so they are merged separately
+            detail::Shards::forEach([&](const detail::Shard& shard) {
+                if (shard.slots[stat.slot].load(std::memory_order::relaxed) == 0) {
+                    return;
+                }
 
-        atomicMin(s_ranges[slot].min, v);
-        atomicMax(s_ranges[slot].max, v);
+                any = true;
 
-        s_anyUsed = true;
-    }
+                min = std::min(min, static_cast<i64>(shard.slots[stat.slot + 1].load(std::memory_order::relaxed)));
+                max = std::max(max, static_cast<i64>(shard.slots[stat.slot + 2].load(std::memory_order::relaxed)));
+            });
 
-    void mean(i64 v, usize slot) {
-        if (slot >= kSlots) {
-            eprintln("tried to hit mean {} (max {})", slot, kSlots - 1);
-            return;
+            if (!any) {
+                return;
+            }
+
+            println("{}:", stat.name);
+            println("    min: {}", min);
+            println("    max: {}", max);
         }
+    } // namespace
 
-        s_means[slot].first += v;
-        ++s_means[slot].second;
+    namespace detail {
+        u32 registerStat(std::string_view name, Kind kind, u32 slotCount) {
+            if (s_usedSlots + slotCount > kMaxSlots) {
+                eprintln("too many stats registered, failed to register {}", name);
+                std::terminate();
+            }
 
-        s_anyUsed = true;
-    }
+            const auto slot = s_usedSlots;
+            s_usedSlots += slotCount;
+
+            registry().push_back({std::string{name}, kind, slot, slotCount});
+
+            return slot;
+        }
+    } // namespace detail
 
     void print() {
-        if (!s_anyUsed.load()) {
+        if (registry().empty()) {
             return;
         }
 
-        for (usize slot = 0; slot < kSlots; ++slot) {
-            const auto hits = s_conditionHits[slot][1].load();
-            const auto misses = s_conditionHits[slot][0].load();
+        const auto totals = mergeShards();
 
-            if (hits == 0 && misses == 0) {
+        const auto total = [&](const StatInfo& stat) {
+            u64 sum{};
+            for (u32 i = 0; i < stat.slotCount; ++i) {
+                sum += totals[stat.slot + i];
+            }
+            return sum;
+        };
+
+        bool printedHeader = false;
+
+        for (const auto& stat : registry()) {
+            if (stat.kind != Kind::kDepthCounter) {
                 continue;
             }
 
-            const auto hitrate = static_cast<f64>(hits) / static_cast<f64>(hits + misses);
+            if (!printedHeader) {
+                stormphrax::print("{:<28} {:>12}", "depth", "total");
+                stormphrax::print(" {:>10}", "qs");
 
-            println("condition {}:", slot);
-            println("    hits: {}", hits);
-            println("    misses: {}", misses);
-            println("    hitrate: {:.6g}%", hitrate * 100);
-        }
+                for (i32 depth = 1; depth < kDepthBuckets - 1; ++depth) {
+                    stormphrax::print(" {:>10}", depth);
+                }
 
-        for (usize slot = 0; slot < kSlots; ++slot) {
-            const auto min = s_ranges[slot].min.load();
-            const auto max = s_ranges[slot].max.load();
+                println(" {:>9}+", kDepthBuckets - 1);
 
-            if (min == std::numeric_limits<i64>::max()) {
-                continue;
+                printedHeader = true;
             }
 
-            println("range {}:", slot);
-            println("    min: {}", min);
-            println("    max: {}", max);
+            stormphrax::print("{:<28} {:>12}", stat.name, total(stat));
+
+            for (i32 depth = 0; depth < kDepthBuckets; ++depth) {
+                stormphrax::print(" {:>10}", totals[stat.slot + depth]);
+            }
+
+            println();
         }
 
-        for (usize slot = 0; slot < kSlots; ++slot) {
-            const auto total = s_means[slot].first.load();
-            const auto count = s_means[slot].second.load();
+        for (const auto& stat : registry()) {
+            switch (stat.kind) {
+                case Kind::kCounter: {
+                    if (const auto count = totals[stat.slot]; count > 0) {
+                        println("{}: {}", stat.name, count);
+                    }
+                    break;
+                }
 
-            if (count == 0) {
-                continue;
-            }
+                case Kind::kCondition: {
+                    const auto misses = totals[stat.slot];
+                    const auto hits = totals[stat.slot + 1];
+
+                    if (hits == 0 && misses == 0) {
+                        break;
+                    }
 
-            const auto mean = static_cast<f64>(total) / static_cast<f64>(count);
+                    const auto hitrate = static_cast<f64>(hits) / static_cast<f64>(hits + misses);
 
-            println("mean {}:", slot);
-            println("    mean: {:.6g}", mean);
-            println("    total: {}", total);
-            println("    count: {}", count);
+                    println("{}:", stat.name);
+                    println("    hits: {}", hits);
+                    println("    misses: {}", misses);
+                    println("    hitrate: {:.6g}%", hitrate * 100);
+
+                    break;
+                }
+
+                case Kind::kMean: {
+                    const auto sum = static_cast<i64>(totals[stat.slot]);
+                    const auto count = totals[stat.slot + 1];
+
+                    if (count == 0) {
+                        break;
+                    }
+
+                    const auto mean = static_cast<f64>(sum) / static_cast<f64>(count);
+
+                    println("{}:", stat.name);
+                    println("    mean: {:.6g}", mean);
+                    println("    total: {}", sum);
+                    println("    count: {}", count);
+
+                    break;
+                }
+
+                case Kind::kRange: {
+                    printRange(stat);
+                    break;
+                }
+
+                default:
+                    break;
+            }
         }
     }
+
+    void reset() {
+        detail::Shards::forEach([](detail::Shard& shard) {
+            for (u32 slot = 0; slot < s_usedSlots; ++slot) {
+                shard.slots[slot].store(0, std::memory_order::relaxed);
+            }
+        });
+    }
 } // namespace stormphrax::stats
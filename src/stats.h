@@ -15,15 +15,178 @@
  * You should have received a copy of the GNU General Public License
  * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
  */
-
 #pragma once
 
 #include "types.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string_view>
+
+#include "util/thread_shards.h"
+
 namespace stormphrax::stats {
-    void conditionHit(bool condition, usize slot = 0);
-    void range(i64 value, usize slot = 0);
-    void mean(i64 value, usize slot = 0);
+#if SP_STATS
+    constexpr bool kEnabled = true;
+#else
+    constexpr bool kEnabled = false;
+#endif
+
+    // maximum number of counter slots across all registered stats
+    constexpr u32 kMaxSlots = 2048;
+
+    // bucket 0 is qsearch, depths past the last bucket are lumped into it
+    constexpr i32 kDepthBuckets = 16;
+
+    enum class Kind : u8 {
+        kCounter = 0,
+        kDepthCounter,
+        kCondition,
+        kMean,
+        kRange,
+    };
+
+    namespace detail {
+        // Every thread counts into its own shard, only ever written by that
+        // thread, so hot counters never share cache lines between threads.
+        // Shards are summed when printing, and outlive the threads that used them
+        struct alignas(64) Shard {
+            std::array<std::atomic<u64>, kMaxSlots> slots{};
+        };
+
+        using Shards = util::ThreadShards<Shard>;
+
+        [[nodiscard]] inline Shard& localShard() {
+            return Shards::local();
+        }
+
+        // not thread safe, stats are registered during static initialisation
+        [[nodiscard]] u32 registerStat(std::string_view name, Kind kind, u32 slotCount);
+
+        inline void add(u32 slot, u64 v) {
+            auto& value = localShard().slots[slot];
+            value.store(value.load(std::memory_order::relaxed) + v, std::memory_order::relaxed);
+        }
+    } // namespace detail
+
+    // All stats are registered by name at construction, and compile
+    // down to nothing unless SP_STATS is enabled. Define them as globals
+
+    class Counter {
+    public:
+        explicit Counter([[maybe_unused]] std::string_view name) {
+            if constexpr (kEnabled) {
+                m_slot = detail::registerStat(name, Kind::kCounter, 1);
+            }
+        }
+
+        inline void inc() const {
+            if constexpr (kEnabled) {
+                detail::add(m_slot, 1);
+            }
+        }
+
+    private:
+        u32 m_slot{};
+    };
+
+    class DepthCounter {
+    public:
+        explicit DepthCounter([[maybe_unused]] std::string_view name) {
+            if constexpr (kEnabled) {
+                m_slot = detail::registerStat(name, Kind::kDepthCounter, kDepthBuckets);
+            }
+        }
+
+        inline void inc([[maybe_unused]] i32 depth) const {
+            if constexpr (kEnabled) {
+                detail::add(m_slot + std::clamp(depth, 0, kDepthBuckets - 1), 1);
+            }
+        }
 
+    private:
+        u32 m_slot{};
+    };
+
+    class Condition {
+    public:
+        explicit Condition([[maybe_unused]] std::string_view name) {
+            if constexpr (kEnabled) {
+                m_slot = detail::registerStat(name, Kind::kCondition, 2);
+            }
+        }
+
+        inline void hit([[maybe_unused]] bool condition) const {
+            if constexpr (kEnabled) {
+                detail::add(m_slot + condition, 1);
+            }
+        }
+
+    private:
+        u32 m_slot{};
+    };
+
+    class Mean {
+    public:
+        explicit Mean([[maybe_unused]] std::string_view name) {
+            if constexpr (kEnabled) {
+                m_slot = detail::registerStat(name, Kind::kMean, 2);
+            }
+        }
+
+        inline void add([[maybe_unused]] i64 value) const {
+            if constexpr (kEnabled) {
+                detail::add(m_slot, static_cast<u64>(value));
+                detail::add(m_slot + 1, 1);
+            }
+        }
+
+    private:
+        u32 m_slot{};
+    };
+
+    class Range {
+    public:
+        explicit Range([[maybe_unused]] std::string_view name) {
+            if constexpr (kEnabled) {
+                m_slot = detail::registerStat(name, Kind::kRange, 3);
+            }
+        }
+
+        inline void add([[maybe_unused]] i64 value) const {
+            if constexpr (kEnabled) {
+                auto& slots = detail::localShard().slots;
+
+                auto& count = slots[m_slot];
+                auto& min = slots[m_slot + 1];
+                auto& max = slots[m_slot + 2];
+
+                const auto v = static_cast<u64>(value);
+
+                if (count.load(std::memory_order::relaxed) == 0
+                    || value < static_cast<i64>(min.load(std::memory_order::relaxed)))
+                {
+                    min.store(v, std::memory_order::relaxed);
+                }
+
+                if (count.load(std::memory_order::relaxed) == 0
+                    || value > static_cast<i64>(max.load(std::memory_order::relaxed)))
+                {
+                    max.store(v, std::memory_order::relaxed);
+                }
+
+                count.store(count.load(std::memory_order::relaxed) + 1, std::memory_order::relaxed);
+            }
+        }
+
+    private:
+        u32 m_slot{};
+    };
+
+    // sums all shards, prints nothing if no stat has been hit
     void print();
+
+    // not thread safe, only call while not searching
+    void reset();
 } // namespace stormphrax::stats
@@ -0,0 +1,156 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tracer.h"
+
+#include <algorithm>
+#include <fmt/ostream.h>
+#include <fstream>
+
+#include "core.h"
+
+namespace stormphrax::tracer {
+    namespace {
+        constexpr std::array<std::array<const char*, 4>, kEventCount> kArgNames{{
+            {"depth", "score", "completed", nullptr},
+            {"depth", "alpha", "beta", "score"},
+            {"depth", "alpha", "beta", "score"},
+            {nullptr, nullptr, nullptr, nullptr},
+            {nullptr, nullptr, nullptr, nullptr},
+        }};
+
+        // names and labels are static strings without anything that needs escaping
+        void writeRecord(std::ostream& stream, u32 tid, const Record& record) {
+            const auto eventIdx = static_cast<usize>(record.event);
+
+            fmt::print(stream, ",\n{{\"name\":\"{}\",\"cat\":\"search\",\"pid\":1,\"tid\":{}", kEventNames[eventIdx], tid);
+
+            // trace event timestamps are in microseconds
+            const auto start = static_cast<f64>(record.start) / 1000.0;
+
+            if (record.instant) {
+                fmt::print(stream, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":{:.3f}", start);
+            } else {
+                const auto duration = static_cast<f64>(record.end - record.start) / 1000.0;
+                fmt::print(stream, ",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f}", start, duration);
+            }
+
+            fmt::print(stream, ",\"args\":{{");
+
+            bool first = true;
+
+            if (record.label) {
+                fmt::print(stream, "\"label\":\"{}\"", record.label);
+                first = false;
+            }
+
+            for (usize i = 0; i < record.args.size(); ++i) {
+                if (const auto* argName = kArgNames[eventIdx][i]) {
+                    fmt::print(stream, "{}\"{}\":{}", first ? "" : ",", argName, record.args[i]);
+                    first = false;
+                }
+            }
+
+            fmt::print(stream, "}}}}");
+        }
+    } // namespace
+
+    namespace detail {
+        Buffer& claimBuffer() {
+            return Buffers::claim([](Buffer& buffer, usize idx) {
+                // tid 0 is the process metadata
+                buffer.tid = static_cast<u32>(idx + 1);
+                buffer.name = fmt::format("thread {}", buffer.tid);
+            });
+        }
+    } // namespace detail
+
+    void setThreadName(std::string_view name) {
+        if constexpr (!kEnabled) {
+            return;
+        }
+
+        auto* buffer = detail::Buffers::current();
+
+        if (!buffer) {
+            buffer = &detail::claimBuffer();
+        }
+
+        const auto lock = detail::Buffers::lock();
+        buffer->name = name;
+    }
+
+    bool dump(const std::string& path) {
+        if constexpr (!kEnabled) {
+            eprintln("tracing not compiled in, build with SP_TRACE");
+            return false;
+        }
+
+        std::ofstream stream{path};
+
+        if (!stream) {
+            eprintln("failed to open {}", path);
+            return false;
+        }
+
+        usize threadCount{};
+        usize eventCount{};
+        usize droppedCount{};
+
+        fmt::print(stream, "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        fmt::print(stream, R"({{"name":"process_name","ph":"M","pid":1,"tid":0,"args":{{"name":"stormphrax"}}}})");
+
+        detail::Buffers::forEach([&](const detail::Buffer& buffer) {
+            fmt::print(
+                stream,
+                ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                buffer.tid,
+                buffer.name
+            );
+
+            const auto head = buffer.head.load(std::memory_order::acquire);
+            const auto count = std::min<u64>(head, kBufferCapacity);
+
+            for (u64 idx = head - count; idx < head; ++idx) {
+                writeRecord(stream, buffer.tid, buffer.records[idx % kBufferCapacity]);
+            }
+
+            ++threadCount;
+            eventCount += count;
+            droppedCount += head - count;
+        });
+
+        fmt::print(stream, "\n]}}\n");
+
+        println(
+            "info string wrote {} trace events from {} threads to {}, {} overwritten",
+            eventCount,
+            threadCount,
+            path,
+            droppedCount
+        );
+
+        return true;
+    }
+
+    void clear() {
+        detail::Buffers::forEach([](detail::Buffer& buffer) {
+            buffer.head.store(0, std::memory_order::relaxed);
+        });
+    }
+} // namespace stormphrax::tracer
@@ -0,0 +1,166 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "util/thread_shards.h"
+
+namespace stormphrax::tracer {
+#if SP_TRACE
+    constexpr bool kEnabled = true;
+#else
+    constexpr bool kEnabled = false;
+#endif
+
+    // per thread, the oldest events are overwritten once full
+    constexpr usize kBufferCapacity = 1 << 14;
+
+    enum class Event : u8 {
+        kIteration = 0,
+        kAspFailHigh,
+        kAspFailLow,
+        kBarrierWait,
+        kTtClear,
+        kCount,
+    };
+
+    constexpr auto kEventCount = static_cast<usize>(Event::kCount);
+
+    constexpr std::array<std::string_view, kEventCount> kEventNames{
+        "iteration",
+        "fail high",
+        "fail low",
+        "barrier wait",
+        "tt clear",
+    };
+
+    struct Record {
+        // ns since process start, end == start for instant events
+        u64 start;
+        u64 end;
+        // static string, e.g. barrier name
+        const char* label;
+        std::array<i32, 4> args;
+        Event event;
+        bool instant;
+    };
+
+    [[nodiscard]] inline u64 now() {
+        static const auto epoch = std::chrono::steady_clock::now();
+        const auto elapsed = std::chrono::steady_clock::now() - epoch;
+        return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    namespace detail {
+        // single producer ring buffer, only read when dumping
+        struct alignas(64) Buffer {
+            std::atomic<u64> head{};
+            u32 tid{};
+            // only accessed under the registry lock
+            std::string name{};
+            std::array<Record, kBufferCapacity> records{};
+        };
+
+        // exited threads keep their events, their buffer is reused by the next new thread
+        using Buffers = util::ThreadShards<Buffer>;
+
+        [[nodiscard]] Buffer& claimBuffer();
+
+        inline void push(const Record& record) {
+            auto* buffer = Buffers::current();
+
+            if (!buffer) [[unlikely]] {
+                buffer = &claimBuffer();
+            }
+
+            const auto head = buffer->head.load(std::memory_order::relaxed);
+            buffer->records[head % kBufferCapacity] = record;
+            buffer->head.store(head + 1, std::memory_order::release);
+        }
+    } // namespace detail
+
+    inline void instant(
+        [[maybe_unused]] Event event,
+        [[maybe_unused]] i32 arg0 = 0,
+        [[maybe_unused]] i32 arg1 = 0,
+        [[maybe_unused]] i32 arg2 = 0,
+        [[maybe_unused]] i32 arg3 = 0
+    ) {
+        if constexpr (kEnabled) {
+            const auto time = now();
+            detail::push({time, time, nullptr, {arg0, arg1, arg2, arg3}, event, true});
+        }
+    }
+
+    // Records a duration event covering its scope. Does nothing
+    // at all unless SP_TRACE is enabled
+    class Span {
+    public:
+        explicit inline Span(
+            [[maybe_unused]] Event event,
+            [[maybe_unused]] const char* label = nullptr,
+            [[maybe_unused]] i32 arg0 = 0
+        ) {
+            if constexpr (kEnabled) {
+                m_event = event;
+                m_label = label;
+                m_args[0] = arg0;
+                m_start = now();
+            }
+        }
+
+        inline ~Span() {
+            if constexpr (kEnabled) {
+                detail::push({m_start, now(), m_label, m_args, m_event, false});
+            }
+        }
+
+        inline void setArg([[maybe_unused]] usize idx, [[maybe_unused]] i32 value) {
+            if constexpr (kEnabled) {
+                m_args[idx] = value;
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span(Span&&) = delete;
+
+    private:
+        Event m_event{};
+        const char* m_label{};
+        std::array<i32, 4> m_args{};
+        u64 m_start{};
+    };
+
+    // names the calling thread in the trace
+    void setThreadName(std::string_view name);
+
+    // writes every buffered event as Chrome trace-event JSON, loadable
+    // in Perfetto or chrome://tracing. not thread safe, only call while not searching
+    bool dump(const std::string& path);
+
+    // not thread safe, only call while not searching
+    void clear();
+} // namespace stormphrax::tracer
@@ -19,11 +19,24 @@
 #include "ttable.h"
 
 #include <bit>
+#include <cstddef>
 #include <cstring>
 #include <thread>
 
-#include "util/align.h"
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include "profiler.h"
 #include "util/cemath.h"
+#include "util/numa.h"
+#include "util/rng.h"
+#include "util/timer.h"
+
+#ifdef SP_TT_WIDE_BUCKETS
+    #include "util/simd.h"
+#endif
 
 namespace stormphrax {
     namespace {
@@ -47,8 +60,50 @@ namespace stormphrax {
             return score;
         }
 
-        inline u16 packEntryKey(u64 key) {
-            return static_cast<u16>(key);
+        // how many clusters the scrub thread clears between checking for a stop
+        constexpr usize kScrubStopCheckInterval = 16384;
+
+        template <typename F>
+        void runOnThreads(u32 threadCount, const F& f) {
+            std::vector<std::thread> threads{};
+            threads.reserve(threadCount);
+
+            for (u32 i = 0; i < threadCount; ++i) {
+                threads.emplace_back([&f, i] { f(i); });
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        // [start, end) of the idx'th of count equal chunks of total elements
+        inline std::pair<usize, usize> chunkBounds(usize total, u32 idx, u32 count) {
+            const auto chunkSize = util::ceilDiv<usize>(total, count);
+
+            const auto start = std::min(chunkSize * idx, total);
+            const auto end = std::min(start + chunkSize, total);
+
+            return {start, end};
+        }
+
+        // smallest and largest keys that map to cluster idx of clusterCount
+        inline std::pair<u64, u64> clusterKeyBounds(u64 idx, usize clusterCount) {
+            const auto first = [clusterCount](u64 i) {
+                return static_cast<u64>(((static_cast<u128>(i) << 64) + clusterCount - 1) / clusterCount);
+            };
+
+            const auto lo = first(idx);
+            const auto hi = idx + 1 == clusterCount ? std::numeric_limits<u64>::max() : first(idx + 1) - 1;
+
+            return {lo, hi};
+        }
+
+        void lowerThisThreadPriority() {
+#ifdef __linux__
+            sched_param param{};
+            pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
         }
     } // namespace
 
@@ -57,21 +112,21 @@ namespace stormphrax {
     }
 
     TTable::~TTable() {
-        if (m_clusters) {
-            util::alignedFree(m_clusters);
-        }
+        stopScrub();
+        util::freeHugePages(m_allocation);
     }
 
     void TTable::resize(usize mib) {
         const auto clusters = mib * 1024 * 1024;
         const auto capacity = clusters / sizeof(Cluster);
 
+        stopScrub();
+
         // don't bother reallocating if we're already at the right size
         if (m_clusterCount != capacity) {
-            if (m_clusters) {
-                util::alignedFree(m_clusters);
-            }
+            util::freeHugePages(m_allocation);
 
+            m_allocation = {};
             m_clusters = nullptr;
             m_clusterCount = capacity;
         }
@@ -79,47 +134,198 @@ namespace stormphrax {
         m_pendingInit = true;
     }
 
-    bool TTable::finalize() {
+    void TTable::resizePreserving(usize mib) {
+        const auto capacity = mib * 1024 * 1024 / sizeof(Cluster);
+
+        if (m_pendingInit || !m_clusters) {
+            resize(mib);
+            return;
+        }
+
+        if (capacity == m_clusterCount) {
+            return;
+        }
+
+        stopScrub();
+
+        const auto start = util::Instant::now();
+
+        const auto oldAllocation = m_allocation;
+        const auto* oldClusters = m_clusters;
+        const auto oldClusterCount = m_clusterCount;
+
+        const auto newAllocation = util::allocHugePages(capacity * sizeof(Cluster), kStorageAlignment);
+
+        if (!newAllocation.ptr) {
+            println("info string Failed to allocate new TT for migration, clearing instead");
+            resize(mib);
+            return;
+        }
+
+        if (m_interleaved && !util::numa::interleave(newAllocation.ptr, newAllocation.size)) {
+            println("info string Failed to interleave TT across NUMA nodes");
+        }
+
+        const auto oldEpoch = m_epoch;
+
+        m_allocation = newAllocation;
+        m_clusters = static_cast<Cluster*>(newAllocation.ptr);
+        m_clusterCount = capacity;
+
+        // every new cluster is written, so this doubles as the clear
+        m_epoch = 0;
+
+        const auto threadCount = g_opts.threads;
+
+        runOnThreads(threadCount, [&](u32 idx) {
+            migrateChunk(oldClusters, oldClusterCount, oldEpoch, idx, threadCount);
+        });
+
+        std::vector<std::pair<usize, usize>> counts(threadCount);
+
+        runOnThreads(threadCount, [&](u32 idx) {
+            counts[idx] = countKeptInChunk(oldClusters, oldClusterCount, oldEpoch, idx, threadCount);
+        });
+
+        util::freeHugePages(oldAllocation);
+
+        m_pendingHugePageReport = newAllocation.pageSize == util::PageSize::kTransparentHuge;
+        reportHugePages();
+
+        usize oldEntries{};
+        usize keptEntries{};
+
+        for (const auto [chunkEntries, chunkKept] : counts) {
+            oldEntries += chunkEntries;
+            keptEntries += chunkKept;
+        }
+
+        const auto fraction = oldEntries == 0 ? 1.0 : static_cast<f64>(keptEntries) / static_cast<f64>(oldEntries);
+
+        println(
+            "info string Migrated TT in {} ms, kept {} of {} entries ({:.1f}%)",
+            static_cast<u32>(start.elapsed() * 1000.0),
+            keptEntries,
+            oldEntries,
+            fraction * 100.0
+        );
+    }
+
+    bool TTable::allocate() {
         if (!m_pendingInit) {
             return false;
         }
 
         m_pendingInit = false;
-        m_clusters = util::alignedAlloc<Cluster>(kStorageAlignment, m_clusterCount);
 
+        // if the size didn't change, keep the existing allocation
         if (!m_clusters) {
-            println("info string Failed to reallocate TT - out of memory?");
-            std::terminate();
+            m_allocation = util::allocHugePages(m_clusterCount * sizeof(Cluster), kStorageAlignment);
+            m_clusters = static_cast<Cluster*>(m_allocation.ptr);
+
+            if (!m_clusters) {
+                println("info string Failed to reallocate TT - out of memory?");
+                std::terminate();
+            }
+
+            println("info string Allocated TT with {}", util::pageSizeName(m_allocation.pageSize));
+
+            m_pendingHugePageReport = m_allocation.pageSize == util::PageSize::kTransparentHuge;
+
+            if (m_interleaved && !util::numa::interleave(m_allocation.ptr, m_allocation.size)) {
+                println("info string Failed to interleave TT across NUMA nodes");
+            }
+        }
+
+        return true;
+    }
+
+    bool TTable::finalize() {
+        if (!allocate()) {
+            return false;
         }
 
         clear();
+        reportHugePages();
 
         return true;
     }
 
+    void TTable::reportHugePages() {
+        if (!m_pendingHugePageReport) {
+            return;
+        }
+
+        m_pendingHugePageReport = false;
+
+        if (const auto bytes = util::transparentHugeBytes(m_allocation)) {
+            constexpr usize kMib = 1024 * 1024;
+
+            println(
+                "info string {} of {} MiB of the TT backed by transparent huge pages",
+                *bytes / kMib,
+                m_allocation.size / kMib
+            );
+        }
+    }
+
+    void TTable::setInterleaved(bool interleaved) {
+        if (interleaved == m_interleaved) {
+            return;
+        }
+
+        m_interleaved = interleaved;
+
+        stopScrub();
+        util::freeHugePages(m_allocation);
+
+        m_allocation = {};
+        m_clusters = nullptr;
+
+        m_pendingInit = true;
+    }
+
     bool TTable::probe(ProbedTTableEntry& dst, u64 key, i32 ply) const {
         assert(!m_pendingInit);
 
-        const auto packedKey = packEntryKey(key);
+        const profiler::ScopedTimer timer{profiler::Component::kTtProbe};
 
-        const auto& cluster = m_clusters[index(key)];
-        for (const auto entry : cluster.entries) {
-            if (packedKey == entry.key) {
-                dst.score = scoreFromTt(static_cast<Score>(entry.score), ply);
-                dst.staticEval = static_cast<Score>(entry.staticEval);
-                dst.depth = entry.depth;
-                dst.move = entry.move;
-                dst.wasPv = entry.pv();
-                dst.flag = entry.flag();
+        // a stale cluster must behave exactly like a zeroed one, key 0 included
+        static constexpr Cluster kEmptyCluster{};
 
-                return true;
-            }
+        const auto* cluster = &m_clusters[index(key)];
+        if (cluster->epoch != m_epoch) {
+            cluster = &kEmptyCluster;
         }
 
-        return false;
+        const auto idx = findKey(*cluster, packKey(key));
+
+        if (idx < 0) {
+            return false;
+        }
+
+        const auto entry = cluster->entries[idx];
+
+        dst.score = scoreFromTt(static_cast<Score>(entry.score), ply);
+        dst.staticEval = static_cast<Score>(entry.staticEval);
+        dst.depth = entry.depth;
+        dst.move = entry.move;
+        dst.wasPv = entry.pv();
+        dst.flag = entry.flag();
+
+        return true;
     }
 
-    void TTable::put(u64 key, Score score, Score staticEval, Move move, i32 depth, i32 ply, TtFlag flag, bool pv) {
+    TtPutResult TTable::put(
+        u64 key,
+        Score score,
+        Score staticEval,
+        Move move,
+        i32 depth,
+        i32 ply,
+        TtFlag flag,
+        bool pv
+    ) {
         assert(!m_pendingInit);
 
         assert(depth >= 0);
@@ -128,7 +334,7 @@ namespace stormphrax {
         assert(staticEval == kScoreNone || staticEval > -kScoreWin);
         assert(staticEval == kScoreNone || staticEval < kScoreWin);
 
-        const auto newKey = packEntryKey(key);
+        const auto newKey = packKey(key);
 
         const auto entryValue = [this](const auto& entry) {
             const i32 relativeAge = (Entry::kAgeCycle + m_age - entry.age()) & Entry::kAgeMask;
@@ -137,13 +343,21 @@ namespace stormphrax {
 
         auto& cluster = m_clusters[index(key)];
 
-        Entry* entryPtr = nullptr;
+        if (cluster.epoch != m_epoch) {
+            cluster.keys = {};
+            cluster.entries = {};
+            cluster.epoch = m_epoch;
+        }
+
+        u32 slot = kEntriesPerCluster;
         auto minValue = std::numeric_limits<i32>::max();
 
-        for (auto& candidate : cluster.entries) {
+        for (u32 i = 0; i < kEntriesPerCluster; ++i) {
+            const auto& candidate = cluster.entries[i];
+
             // always take an empty entry, or one from the same position
-            if (candidate.key == newKey || candidate.flag() == TtFlag::kNone) {
-                entryPtr = &candidate;
+            if (cluster.keys[i] == newKey || candidate.flag() == TtFlag::kNone) {
+                slot = i;
                 break;
             }
 
@@ -151,61 +365,331 @@ namespace stormphrax {
             const auto value = entryValue(candidate);
 
             if (value < minValue) {
-                entryPtr = &candidate;
+                slot = i;
                 minValue = value;
             }
         }
 
-        assert(entryPtr != nullptr);
+        assert(slot < kEntriesPerCluster);
 
-        auto entry = *entryPtr;
+        const auto entryKey = cluster.keys[slot];
+        auto entry = cluster.entries[slot];
 
         // Roughly the SF replacement scheme
-        if (!(flag == TtFlag::kExact || newKey != entry.key || entry.age() != m_age || depth + 4 + pv * 2 > entry.depth
-            ))
+        if (!(flag == TtFlag::kExact || newKey != entryKey || entry.age() != m_age || depth + 4 + pv * 2 > entry.depth))
         {
-            return;
+            return TtPutResult::kSkipped;
         }
 
-        if (move || entry.key != newKey) {
+        // eval-only entries also have no flag, but do have a key
+        const bool empty = entry.flag() == TtFlag::kNone && entryKey == 0;
+
+        const auto result = empty                         ? TtPutResult::kEmptySlot
+                          : entryKey == newKey            ? TtPutResult::kSameKey
+                          : entry.flag() == TtFlag::kNone ? TtPutResult::kEvalOnly
+                                                          : TtPutResult::kOtherKey;
+
+        if (move || entryKey != newKey) {
             entry.move = move;
         }
 
-        entry.key = newKey;
         entry.score = static_cast<i16>(scoreToTt(score, ply));
         entry.staticEval = static_cast<i16>(staticEval);
         entry.depth = depth;
         entry.setAgePvFlag(m_age, pv, flag);
 
-        *entryPtr = entry;
+        cluster.keys[slot] = newKey;
+        cluster.entries[slot] = entry;
+
+        return result;
     }
 
     void TTable::clear() {
         assert(!m_pendingInit);
 
+        stopScrub();
+
         const auto threadCount = g_opts.threads;
+        runOnThreads(threadCount, [this, threadCount](u32 idx) { clearChunk(idx, threadCount); });
+    }
 
-        std::vector<std::thread> threads{};
-        threads.reserve(threadCount);
+    void TTable::clearChunk(u32 idx, u32 count) {
+        assert(!m_pendingInit);
+        assert(idx < count);
 
-        const auto chunkSize = util::ceilDiv<usize>(m_clusterCount, threadCount);
+        const auto [start, end] = chunkBounds(m_clusterCount, idx, count);
 
-        for (u32 i = 0; i < threadCount; ++i) {
-            threads.emplace_back([this, chunkSize, i] {
-                const auto start = chunkSize * i;
-                const auto end = std::min(start + chunkSize, m_clusterCount);
+        std::memset(&m_clusters[start], 0, (end - start) * sizeof(Cluster));
 
-                const auto count = end - start;
+        if (idx == 0) {
+            m_age = 0;
+            m_epoch = 0;
+        }
+    }
 
-                std::memset(&m_clusters[start], 0, count * sizeof(Cluster));
-            });
+    bool TTable::advanceEpoch() {
+        assert(!m_pendingInit);
+
+        stopScrub();
+
+        if (m_epoch == std::numeric_limits<u16>::max()) {
+            return false;
         }
 
+        ++m_epoch;
         m_age = 0;
 
-        for (auto& thread : threads) {
-            thread.join();
+        return true;
+    }
+
+    void TTable::startScrub() {
+        assert(!m_pendingInit);
+
+        stopScrub();
+
+        m_stopScrub.store(false, std::memory_order::relaxed);
+        m_scrubThread = std::thread{[this] { scrub(); }};
+    }
+
+    void TTable::stopScrub() {
+        if (!m_scrubThread.joinable()) {
+            return;
+        }
+
+        m_stopScrub.store(true, std::memory_order::relaxed);
+        m_scrubThread.join();
+    }
+
+    void TTable::scrub() {
+        lowerThisThreadPriority();
+
+        for (usize i = 0; i < m_clusterCount; ++i) {
+            if (i % kScrubStopCheckInterval == 0 && m_stopScrub.load(std::memory_order::relaxed)) {
+                return;
+            }
+
+            auto& cluster = m_clusters[i];
+
+            if (cluster.epoch != m_epoch) {
+                cluster.keys = {};
+                cluster.entries = {};
+                cluster.epoch = m_epoch;
+            }
+        }
+    }
+
+    i32 TTable::findKey(const Cluster& cluster, PackedKey key) {
+#ifdef SP_TT_WIDE_BUCKETS
+        using namespace util::simd;
+
+        static constexpr usize kKeysPerVector = kChunkSize<i32>;
+        static constexpr usize kVectors = util::ceilDiv(kEntriesPerCluster, kKeysPerVector);
+
+        static_assert(kVectors * sizeof(Vector<i32>) <= sizeof(Cluster));
+        static_assert(offsetof(Cluster, keys) == 0);
+
+        // loaded through the cluster as a whole, as the last vector extends past the keys
+        const auto* base = reinterpret_cast<const std::byte*>(&cluster);
+
+        const auto target = set1<i32>(static_cast<i32>(key));
+
+        u64 mask{};
+
+        // lanes past the keys compare against the rest of the cluster, and are masked out
+        for (usize i = 0; i < kVectors; ++i) {
+            const auto keys = load<i32>(base + i * sizeof(Vector<i32>));
+            mask |= static_cast<u64>(equalMask<i32>(keys, target)) << (i * kKeysPerVector);
+        }
+
+        mask &= (u64{1} << kEntriesPerCluster) - 1;
+
+        return mask == 0 ? -1 : std::countr_zero(mask);
+#else
+        for (u32 i = 0; i < kEntriesPerCluster; ++i) {
+            if (cluster.keys[i] == key) {
+                return static_cast<i32>(i);
+            }
+        }
+
+        return -1;
+#endif
+    }
+
+    void TTable::migrateChunk(
+        const Cluster* oldClusters,
+        usize oldClusterCount,
+        u16 oldEpoch,
+        u32 idx,
+        u32 count
+    ) {
+        const auto [start, end] = chunkBounds(m_clusterCount, idx, count);
+
+        const auto entryValue = [this](const Entry& entry) {
+            const i32 relativeAge = (Entry::kAgeCycle + m_age - entry.age()) & Entry::kAgeMask;
+            return entry.depth - relativeAge * 2;
+        };
+
+        for (usize newIdx = start; newIdx < end; ++newIdx) {
+            const auto [lo, hi] = clusterKeyBounds(newIdx, m_clusterCount);
+
+            const auto firstOld = index(lo, oldClusterCount);
+            const auto lastOld = index(hi, oldClusterCount);
+
+            Cluster cluster{};
+            std::array<i32, kEntriesPerCluster> values{};
+
+            u32 filled = 0;
+
+            for (auto oldIdx = firstOld; oldIdx <= lastOld; ++oldIdx) {
+                const auto& oldCluster = oldClusters[oldIdx];
+
+                if (oldCluster.epoch != oldEpoch) {
+                    continue;
+                }
+
+                for (u32 oldSlot = 0; oldSlot < kEntriesPerCluster; ++oldSlot) {
+                    const auto key = oldCluster.keys[oldSlot];
+                    const auto& entry = oldCluster.entries[oldSlot];
+
+                    if (entry.flag() == TtFlag::kNone) {
+                        continue;
+                    }
+
+                    const auto value = entryValue(entry);
+
+                    // entries from different old clusters can share a packed key,
+                    // and probe() would only ever see the first of them
+                    const auto duplicate = std::find(cluster.keys.begin(), cluster.keys.begin() + filled, key);
+
+                    u32 slot;
+
+                    if (duplicate != cluster.keys.begin() + filled) {
+                        slot = std::distance(cluster.keys.begin(), duplicate);
+                    } else if (filled < kEntriesPerCluster) {
+                        slot = filled++;
+                        values[slot] = std::numeric_limits<i32>::min();
+                    } else {
+                        slot = std::distance(values.begin(), std::ranges::min_element(values));
+                    }
+
+                    if (value > values[slot]) {
+                        cluster.keys[slot] = key;
+                        cluster.entries[slot] = entry;
+                        values[slot] = value;
+                    }
+                }
+            }
+
+            cluster.epoch = m_epoch;
+            m_clusters[newIdx] = cluster;
+        }
+    }
+
+    std::pair<usize, usize> TTable::countKeptInChunk(
+        const Cluster* oldClusters,
+        usize oldClusterCount,
+        u16 oldEpoch,
+        u32 idx,
+        u32 count
+    ) const {
+        const auto [start, end] = chunkBounds(oldClusterCount, idx, count);
+
+        usize entries{};
+        usize kept{};
+
+        for (usize oldIdx = start; oldIdx < end; ++oldIdx) {
+            const auto& oldCluster = oldClusters[oldIdx];
+
+            if (oldCluster.epoch != oldEpoch) {
+                continue;
+            }
+
+            const auto [lo, hi] = clusterKeyBounds(oldIdx, oldClusterCount);
+
+            const auto firstNew = index(lo);
+            const auto lastNew = index(hi);
+
+            for (u32 oldSlot = 0; oldSlot < kEntriesPerCluster; ++oldSlot) {
+                const auto key = oldCluster.keys[oldSlot];
+                const auto& entry = oldCluster.entries[oldSlot];
+
+                if (entry.flag() == TtFlag::kNone) {
+                    continue;
+                }
+
+                ++entries;
+
+                const auto found = [&] {
+                    for (auto newIdx = firstNew; newIdx <= lastNew; ++newIdx) {
+                        const auto& newCluster = m_clusters[newIdx];
+
+                        for (u32 newSlot = 0; newSlot < kEntriesPerCluster; ++newSlot) {
+                            if (newCluster.keys[newSlot] == key
+                                && std::memcmp(&newCluster.entries[newSlot], &entry, sizeof(Entry)) == 0)
+                            {
+                                return true;
+                            }
+                        }
+                    }
+
+                    return false;
+                }();
+
+                if (found) {
+                    ++kept;
+                }
+            }
         }
+
+        return {entries, kept};
+    }
+
+    usize TTable::persistedSize() const {
+        return sizeof(PersistedHeader) + m_clusterCount * sizeof(Cluster);
+    }
+
+    bool TTable::writeTo(std::ostream& stream) const {
+        assert(!m_pendingInit);
+
+        const PersistedHeader header{.age = m_age, .epoch = m_epoch, .padding = 0};
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        stream.write(
+            reinterpret_cast<const char*>(m_clusters),
+            static_cast<std::streamsize>(m_clusterCount * sizeof(Cluster))
+        );
+
+        return static_cast<bool>(stream);
+    }
+
+    bool TTable::readFrom(std::span<const std::byte> data) {
+        assert(!m_pendingInit);
+
+        if (data.size() != persistedSize()) {
+            return false;
+        }
+
+        stopScrub();
+
+        PersistedHeader header{};
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        if (header.age >= Entry::kAgeCycle) {
+            return false;
+        }
+
+        const auto* clusters = data.data() + sizeof(header);
+        const auto threadCount = g_opts.threads;
+
+        runOnThreads(threadCount, [&](u32 idx) {
+            const auto [start, end] = chunkBounds(m_clusterCount, idx, threadCount);
+            std::memcpy(&m_clusters[start], clusters + start * sizeof(Cluster), (end - start) * sizeof(Cluster));
+        });
+
+        m_age = header.age;
+        m_epoch = header.epoch;
+
+        return true;
     }
 
     u32 TTable::full() const {
@@ -215,6 +699,11 @@ namespace stormphrax {
 
         for (u64 i = 0; i < 1000; ++i) {
             const auto cluster = m_clusters[i];
+
+            if (cluster.epoch != m_epoch) {
+                continue;
+            }
+
             for (const auto& entry : cluster.entries) {
                 if (entry.flag() != TtFlag::kNone && entry.age() == m_age) {
                     ++filledEntries;
@@ -222,6 +711,39 @@ namespace stormphrax {
             }
         }
 
-        return filledEntries / Cluster::kEntriesPerCluster;
+        return filledEntries / kEntriesPerCluster;
+    }
+
+    TtSample TTable::sample(usize clusterCount, u64 seed) const {
+        assert(!m_pendingInit);
+
+        TtSample result{};
+        result.relativeAges.resize(Entry::kAgeCycle);
+
+        util::rng::Jsf64Rng rng{seed};
+
+        for (usize i = 0; i < clusterCount; ++i) {
+            const auto& cluster = m_clusters[index(rng.nextU64())];
+
+            ++result.clusters;
+
+            if (cluster.epoch != m_epoch) {
+                continue;
+            }
+
+            for (const auto& entry : cluster.entries) {
+                if (entry.flag() == TtFlag::kNone) {
+                    continue;
+                }
+
+                const u32 relativeAge = (Entry::kAgeCycle + m_age - entry.age()) & Entry::kAgeMask;
+
+                ++result.entries;
+                ++result.depths[entry.depth];
+                ++result.relativeAges[relativeAge];
+            }
+        }
+
+        return result;
     }
 } // namespace stormphrax
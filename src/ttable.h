@@ -20,14 +20,19 @@
 
 #include "types.h"
 
+#include <array>
 #include <atomic>
 #include <bit>
 #include <cstring>
+#include <ostream>
+#include <span>
+#include <thread>
 #include <vector>
 
 #include "arch.h"
 #include "core.h"
 #include "move.h"
+#include "util/large_pages.h"
 #include "util/range.h"
 
 namespace stormphrax {
@@ -50,37 +55,163 @@ namespace stormphrax {
         TtFlag flag;
     };
 
+    enum class TtPutResult : u8 {
+        // the replacement scheme kept the existing entry
+        kSkipped = 0,
+        kEmptySlot,
+        kSameKey,
+        kOtherKey,
+        // replaced an eval-only entry for another position
+        kEvalOnly,
+    };
+
+    // Per-thread TT counters, only collected in builds with SP_TT_STATS.
+    // Cover everything since the last ucinewgame
+    struct TtStats {
+        u64 probes{};
+        u64 hits{};
+        // hits that caused a TT cutoff
+        u64 cutoffHits{};
+
+        // indexed by TtPutResult
+        std::array<u64, 5> puts{};
+
+        inline void recordPut(TtPutResult result) {
+            ++puts[static_cast<i32>(result)];
+        }
+
+        inline TtStats& operator+=(const TtStats& other) {
+            probes += other.probes;
+            hits += other.hits;
+            cutoffHits += other.cutoffHits;
+
+            for (usize i = 0; i < puts.size(); ++i) {
+                puts[i] += other.puts[i];
+            }
+
+            return *this;
+        }
+    };
+
+    // Histograms of live entries in a random sample of clusters
+    struct TtSample {
+        usize clusters{};
+        usize entries{};
+
+        // indexed by depth
+        std::array<usize, 256> depths{};
+        // indexed by age relative to the table's current age
+        std::vector<usize> relativeAges{};
+    };
+
     class TTable {
     public:
         explicit TTable(usize mib = kDefaultTtSizeMib);
         ~TTable();
 
         void resize(usize mib);
+        // Resizes the table, rehashing live entries from the old table into the
+        // new one in parallel instead of discarding them. Both tables are alive
+        // at once while migrating. Falls back to resize() if there is nothing
+        // to preserve
+        void resizePreserving(usize mib);
+
+        // Allocates the table if required, without clearing it
+        bool allocate();
+        // Allocates and clears the table if required
         bool finalize();
 
+        // After a new allocation that requested transparent huge pages has been touched,
+        // prints how much of it the kernel actually backed with them
+        void reportHugePages();
+
+        // Forces a reallocation on the next finalize() if changed
+        void setInterleaved(bool interleaved);
+
         bool probe(ProbedTTableEntry& dst, u64 key, i32 ply) const;
-        void put(u64 key, Score score, Score staticEval, Move move, i32 depth, i32 ply, TtFlag flag, bool pv);
+        TtPutResult put(u64 key, Score score, Score staticEval, Move move, i32 depth, i32 ply, TtFlag flag, bool pv);
 
         inline void age() {
             m_age = (m_age + 1) % (1 << Entry::kAgeBits);
         }
 
+        // Physically zeroes the table. Use advanceEpoch() between games instead
         void clear();
 
+        // Logically clears the table in O(1) by starting a new epoch - entries
+        // written in earlier epochs are treated exactly like zeroed entries.
+        // Returns false if the epoch counter would wrap, in which case stale
+        // entries could become visible again and the table must be physically
+        // cleared instead (which also resets the epoch)
+        [[nodiscard]] bool advanceEpoch();
+
+        // Starts a low-priority background thread that zeroes clusters left
+        // over from earlier epochs. Must be stopped before searching again
+        void startScrub();
+        void stopScrub();
+
+        // Clears the idx'th of count equal chunks of the table. Used to clear
+        // the table from pinned search threads, so that it gets first-touched
+        // on the right NUMA nodes. The 0th chunk also resets the table's age
+        // and epoch
+        void clearChunk(u32 idx, u32 count);
+
         [[nodiscard]] u32 full() const;
 
+        [[nodiscard]] TtSample sample(usize clusterCount, u64 seed) const;
+
+        [[nodiscard]] inline usize clusterCount() const {
+            return m_clusterCount;
+        }
+
+        [[nodiscard]] static constexpr usize clusterSize() {
+            return sizeof(Cluster);
+        }
+
+        [[nodiscard]] static constexpr usize entriesPerCluster() {
+            return kEntriesPerCluster;
+        }
+
+        [[nodiscard]] static constexpr u32 keyBits() {
+            return sizeof(PackedKey) * 8;
+        }
+
+        // Size in bytes of the data written by writeTo()
+        [[nodiscard]] usize persistedSize() const;
+
+        // Writes the table's age, epoch and raw clusters
+        bool writeTo(std::ostream& stream) const;
+        // Reads data written by writeTo() from a table of the same geometry,
+        // copying it in parallel
+        bool readFrom(std::span<const std::byte> data);
+
         inline void prefetch(u64 key) {
             __builtin_prefetch(&m_clusters[index(key)]);
         }
 
     private:
+#ifdef SP_TT_WIDE_BUCKETS
+        // one cache line per cluster, with wider keys packed together at the
+        // front so that probe() can compare all of them at once
+        using PackedKey = u32;
+
+        static constexpr usize kEntriesPerCluster = 5;
+        static constexpr usize kClusterAlignment = 64;
+#else
+        using PackedKey = u16;
+
+        static constexpr usize kEntriesPerCluster = 3;
+        static constexpr usize kClusterAlignment = 32;
+#endif
+
+        static constexpr auto kStorageAlignment = std::max(kCacheLineSize, kClusterAlignment);
+
         struct Entry {
             static constexpr u32 kAgeBits = 5;
 
             static constexpr u32 kAgeCycle = 1 << kAgeBits;
             static constexpr u32 kAgeMask = kAgeCycle - 1;
 
-            u16 key;
             i16 score;
             i16 staticEval;
             Move move;
@@ -105,33 +236,71 @@ namespace stormphrax {
             }
         };
 
-        static_assert(sizeof(Entry) == 10);
+        static_assert(sizeof(Entry) == 8);
 
-        static constexpr usize kClusterAlignment = 32;
-        static constexpr auto kStorageAlignment = std::max(kCacheLineSize, kClusterAlignment);
+        struct alignas(kClusterAlignment) Cluster {
+            std::array<PackedKey, kEntriesPerCluster> keys{};
+            // lives in what would otherwise be padding
+            u16 epoch{};
+            std::array<Entry, kEntriesPerCluster> entries{};
+        };
 
-        struct alignas(32) Cluster {
-            static constexpr usize kEntriesPerCluster = 3;
+        static_assert(sizeof(Cluster) == kClusterAlignment);
 
-            std::array<Entry, kEntriesPerCluster> entries{};
+        [[nodiscard]] static inline PackedKey packKey(u64 key) {
+            return static_cast<PackedKey>(key);
+        }
 
-            // round up to nearest power of 2 bytes
-            [[maybe_unused]] std::array<
-                u8,
-                std::bit_ceil(sizeof(Entry) * kEntriesPerCluster) - sizeof(Entry) * kEntriesPerCluster> padding{};
-        };
+        // Index of the first entry in the cluster with the given key, or -1
+        [[nodiscard]] static i32 findKey(const Cluster& cluster, PackedKey key);
 
-        [[nodiscard]] inline u64 index(u64 key) const {
+        [[nodiscard]] static inline u64 index(u64 key, usize clusterCount) {
             // this emits a single mul on both x64 and arm64
-            return static_cast<u64>((static_cast<u128>(key) * static_cast<u128>(m_clusterCount)) >> 64);
+            return static_cast<u64>((static_cast<u128>(key) * static_cast<u128>(clusterCount)) >> 64);
+        }
+
+        [[nodiscard]] inline u64 index(u64 key) const {
+            return index(key, m_clusterCount);
         }
 
+        // Entries only store the low bits of their key, so a cluster's entries can
+        // only be narrowed down to the range of new clusters that the old
+        // cluster's key range maps to. Migrated entries are copied into each
+        // of those, where they compete by depth and age like in put()
+        void migrateChunk(const Cluster* oldClusters, usize oldClusterCount, u16 oldEpoch, u32 idx, u32 count);
+        // Returns the number of live entries in the idx'th chunk of the old
+        // table, and how many of those made it into the new one
+        [[nodiscard]] std::pair<usize, usize> countKeptInChunk(
+            const Cluster* oldClusters,
+            usize oldClusterCount,
+            u16 oldEpoch,
+            u32 idx,
+            u32 count
+        ) const;
+
+        void scrub();
+
+        struct PersistedHeader {
+            u32 age;
+            u16 epoch;
+            [[maybe_unused]] u16 padding;
+        };
+
         // Only accessed from UCI thread
         bool m_pendingInit{};
+        bool m_interleaved{};
 
         Cluster* m_clusters{};
         usize m_clusterCount{};
 
+        util::PageAllocation m_allocation{};
+        // set by allocations that requested transparent huge pages
+        bool m_pendingHugePageReport{};
+
         u32 m_age{};
+        u16 m_epoch{};
+
+        std::thread m_scrubThread{};
+        std::atomic_bool m_stopScrub{};
     };
 } // namespace stormphrax
@@ -22,6 +22,8 @@
 #include <cctype>
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -37,8 +39,10 @@
 #include "position/position.h"
 #include "search.h"
 #include "tb.h"
+#include "tracer.h"
 #include "ttable.h"
 #include "tunable.h"
+#include "util/numa.h"
 #include "util/parse.h"
 #include "util/split.h"
 #include "util/timer.h"
@@ -54,6 +58,21 @@ namespace stormphrax {
         constexpr auto kVersion = SP_STRINGIFY(SP_VERSION);
         constexpr auto kAuthor = "Ciekce";
 
+        // for paths that may contain spaces
+        inline std::string joinArgs(std::span<const std::string_view> args) {
+            std::string result{};
+
+            for (const auto arg : args) {
+                if (!result.empty()) {
+                    result += ' ';
+                }
+
+                result += arg;
+            }
+
+            return result;
+        }
+
 #if SP_EXTERNAL_TUNE
         std::vector<tunable::TunableParam>& tunableParams() {
             static auto params = [] {
@@ -76,6 +95,19 @@ namespace stormphrax {
         }
 #endif
 
+        // limits from a go command, kept so that
+        // the limiter can be rebuilt on ponderhit
+        struct GoLimits {
+            std::optional<usize> nodes{};
+            std::optional<i64> moveTime{};
+
+            bool tournamentTime{false};
+
+            i64 timeRemaining{};
+            i64 increment{};
+            i32 toGo{};
+        };
+
         class UciHandler {
         public:
             ~UciHandler();
@@ -89,6 +121,7 @@ namespace stormphrax {
             void handlePosition(std::span<const std::string_view> args);
             void handleGo(std::span<const std::string_view> args, Instant startTime);
             void handleStop();
+            void handlePonderhit(Instant startTime);
             void handleSetoption(std::span<const std::string_view> args);
             // V ======= NONSTANDARD ======= V
             void handleD();
@@ -104,6 +137,10 @@ namespace stormphrax {
             void handleBench(std::span<const std::string_view> args);
             void handleProbeWdl();
             void handleWait();
+            void handleTtStats(std::span<const std::string_view> args);
+            void handleSaveState(std::span<const std::string_view> args);
+            void handleLoadState(std::span<const std::string_view> args);
+            void handleTrace(std::span<const std::string_view> args);
 
             bool m_tbInitialized{false};
 
@@ -113,6 +150,14 @@ namespace stormphrax {
             Position m_pos{Position::starting()};
 
             i32 m_moveOverhead{limit::kDefaultMoveOverhead};
+
+            // limits of the current go ponder, if any
+            std::optional<GoLimits> m_ponderLimits{};
+
+            [[nodiscard]] std::unique_ptr<limit::ISearchLimiter> createLimiter(
+                const GoLimits& limits,
+                Instant startTime
+            ) const;
         };
 
         UciHandler::~UciHandler() {
@@ -122,6 +167,8 @@ namespace stormphrax {
         }
 
         i32 UciHandler::run() {
+            tracer::setThreadName("uci");
+
             std::vector<std::string_view> tokens{};
 
             for (std::string line{}; std::getline(std::cin, line);) {
@@ -137,6 +184,12 @@ namespace stormphrax {
                 const auto command = tokens[0];
                 const auto args = std::span{tokens}.subspan<1>();
 
+                // deferred until first needed, so that setting EvalFile to
+                // a network cache avoids decompressing the embedded network
+                if (command != "uci" && command != "setoption" && command != "quit") {
+                    eval::ensureNetworkLoaded();
+                }
+
                 if (command == "quit") {
                     return 0;
                 } else if (command == "uci") {
@@ -151,6 +204,8 @@ namespace stormphrax {
                     handleGo(args, startTime);
                 } else if (command == "stop") {
                     handleStop();
+                } else if (command == "ponderhit") {
+                    handlePonderhit(startTime);
                 } else if (command == "setoption") {
                     handleSetoption(args);
                     // V ======= NONSTANDARD ======= V
@@ -180,6 +235,14 @@ namespace stormphrax {
                     handleProbeWdl();
                 } else if (command == "wait") {
                     handleWait();
+                } else if (command == "ttstats") {
+                    handleTtStats(args);
+                } else if (command == "savestate") {
+                    handleSaveState(args);
+                } else if (command == "loadstate") {
+                    handleLoadState(args);
+                } else if (command == "trace") {
+                    handleTrace(args);
                 }
             }
 
@@ -203,12 +266,17 @@ namespace stormphrax {
                 kTtSizeMibRange.max()
             );
             println("option name Clear Hash type button");
+            println("option name HashScrub type check default {}", defaultOpts.hashScrub);
+            println("option name PreserveHashOnResize type check default {}", defaultOpts.preserveHashOnResize);
+            println("option name TTEvalWrites type check default {}", defaultOpts.ttEvalWrites);
             println(
                 "option name Threads type spin default {} min {} max {}",
                 opts::kDefaultThreadCount,
                 opts::kThreadCountRange.min(),
                 opts::kThreadCountRange.max()
             );
+            println("option name NUMA type combo default auto var auto var on var off");
+            println("option name SMPMode type combo default lazy var lazy var abdada");
             println(
                 "option name MultiPV type spin default {} min {} max {}",
                 defaultOpts.multiPv,
@@ -224,6 +292,8 @@ namespace stormphrax {
             println("option name UCI_Chess960 type check default {}", defaultOpts.chess960);
             println("option name UCI_ShowWDL type check default {}", defaultOpts.showWdl);
             println("option name ShowCurrMove type check default {}", defaultOpts.showCurrMove);
+            println("option name ShowStartLatency type check default {}", defaultOpts.showStartLatency);
+            println("option name Ponder type check default {}", defaultOpts.ponder);
             println(
                 "option name Move Overhead type spin default {} min {} max {}",
                 limit::kDefaultMoveOverhead,
@@ -252,6 +322,7 @@ namespace stormphrax {
                 search::kSyzygyProbeLimitRange.max()
             );
             println("option name EvalFile type string default <internal>");
+            println("option name SharedNetwork type check default {}", defaultOpts.sharedNetwork);
 
 #if SP_EXTERNAL_TUNE
             for (const auto& param : tunableParams()) {
@@ -380,16 +451,12 @@ namespace stormphrax {
             }
 
             u32 depth = kMaxDepth;
-            auto limiter = std::make_unique<limit::CompoundLimiter>();
+            GoLimits limits{};
 
             MoveList movesToSearch{};
 
             bool infinite = false;
-            bool tournamentTime = false;
-
-            i64 timeRemaining{};
-            i64 increment{};
-            i32 toGo{};
+            bool ponder = false;
 
             for (usize i = 0; i < args.size(); ++i) {
                 if (args[i] == "depth" && ++i < args.size()) {
@@ -404,54 +471,58 @@ namespace stormphrax {
                     continue;
                 }
 
+                if (args[i] == "ponder") {
+                    ponder = true;
+                    continue;
+                }
+
                 if (args[i] == "nodes" && ++i < args.size()) {
                     usize nodes{};
                     if (!util::tryParse<usize>(nodes, args[i])) {
                         eprintln("invalid node count {}", args[i]);
                     } else {
-                        limiter->addLimiter<limit::NodeLimiter>(nodes);
+                        limits.nodes = nodes;
                     }
                 } else if (args[i] == "movetime" && ++i < args.size()) {
                     i64 time{};
                     if (!util::tryParse<i64>(time, args[i])) {
                         eprintln("invalid time {}", args[i]);
                     } else {
-                        time = std::max<i64>(time, 1);
-                        limiter->addLimiter<limit::MoveTimeLimiter>(time, m_moveOverhead);
+                        limits.moveTime = std::max<i64>(time, 1);
                     }
                 } else if ((args[i] == "btime" || args[i] == "wtime") && ++i < args.size()
                            && args[i - 1] == (m_pos.stm() == Color::kBlack ? "btime" : "wtime"))
                 {
-                    tournamentTime = true;
+                    limits.tournamentTime = true;
 
                     i64 time{};
                     if (!util::tryParse<i64>(time, args[i])) {
                         eprintln("invalid time {}", args[i]);
                     } else {
                         time = std::max<i64>(time, 1);
-                        timeRemaining = static_cast<i64>(time);
+                        limits.timeRemaining = static_cast<i64>(time);
                     }
                 } else if ((args[i] == "binc" || args[i] == "winc") && ++i < args.size()
                            && args[i - 1] == (m_pos.stm() == Color::kBlack ? "binc" : "winc"))
                 {
-                    tournamentTime = true;
+                    limits.tournamentTime = true;
 
                     i64 time{};
                     if (!util::tryParse<i64>(time, args[i])) {
                         eprintln("invalid time {}", args[i]);
                     } else {
                         time = std::max<i64>(time, 1);
-                        increment = static_cast<i64>(time);
+                        limits.increment = static_cast<i64>(time);
                     }
                 } else if (args[i] == "movestogo" && ++i < args.size()) {
-                    tournamentTime = true;
+                    limits.tournamentTime = true;
 
                     u32 moves{};
                     if (!util::tryParse<u32>(moves, args[i])) {
                         eprintln("invalid movestogo {}", args[i]);
                     } else {
                         moves = std::min<u32>(moves, static_cast<u32>(std::numeric_limits<i32>::max()));
-                        toGo = static_cast<i32>(moves);
+                        limits.toGo = static_cast<i32>(moves);
                     }
                 } else if (args[i] == "searchmoves" && i + 1 < args.size()) {
                     while (i + 1 < args.size()) {
@@ -498,8 +569,8 @@ namespace stormphrax {
                 depth = kMaxDepth;
             }
 
-            if (tournamentTime) {
-                if (toGo != 0) {
+            if (limits.tournamentTime) {
+                if (limits.toGo != 0) {
                     if (g_opts.enableWeirdTcs) {
                         println(
                             "info string Warning: Stormphrax does not officially support cyclic (movestogo) time controls"
@@ -511,7 +582,7 @@ namespace stormphrax {
                         println("bestmove 0000");
                         return;
                     }
-                } else if (increment == 0) {
+                } else if (limits.increment == 0) {
                     if (g_opts.enableWeirdTcs) {
                         println(
                             "info string Warning: Stormphrax does not officially support sudden death (0 increment) time controls"
@@ -526,14 +597,15 @@ namespace stormphrax {
                 }
             }
 
-            if (tournamentTime && timeRemaining > 0) {
-                limiter->addLimiter<limit::TimeManager>(
-                    startTime,
-                    static_cast<f64>(timeRemaining) / 1000.0,
-                    static_cast<f64>(increment) / 1000.0,
-                    toGo,
-                    static_cast<f64>(m_moveOverhead) / 1000.0
-                );
+            std::unique_ptr<limit::ISearchLimiter> limiter{};
+
+            // ponder with no limits, the real ones start on ponderhit
+            if (ponder) {
+                m_ponderLimits = limits;
+                limiter = std::make_unique<limit::InfiniteLimiter>();
+            } else {
+                m_ponderLimits.reset();
+                limiter = createLimiter(limits, startTime);
             }
 
             m_searcher.startSearch(
@@ -543,10 +615,38 @@ namespace stormphrax {
                 static_cast<i32>(depth),
                 movesToSearch,
                 std::move(limiter),
-                infinite
+                infinite,
+                ponder
             );
         }
 
+        std::unique_ptr<limit::ISearchLimiter> UciHandler::createLimiter(
+            const GoLimits& limits,
+            Instant startTime
+        ) const {
+            auto limiter = std::make_unique<limit::CompoundLimiter>();
+
+            if (limits.nodes) {
+                limiter->addLimiter<limit::NodeLimiter>(*limits.nodes);
+            }
+
+            if (limits.moveTime) {
+                limiter->addLimiter<limit::MoveTimeLimiter>(*limits.moveTime, m_moveOverhead);
+            }
+
+            if (limits.tournamentTime && limits.timeRemaining > 0) {
+                limiter->addLimiter<limit::TimeManager>(
+                    startTime,
+                    static_cast<f64>(limits.timeRemaining) / 1000.0,
+                    static_cast<f64>(limits.increment) / 1000.0,
+                    limits.toGo,
+                    static_cast<f64>(m_moveOverhead) / 1000.0
+                );
+            }
+
+            return limiter;
+        }
+
         void UciHandler::handleStop() {
             if (!m_searcher.searching()) {
                 eprintln("not searching");
@@ -556,6 +656,16 @@ namespace stormphrax {
             m_searcher.stop();
         }
 
+        void UciHandler::handlePonderhit(Instant startTime) {
+            if (!m_searcher.pondering() || !m_ponderLimits) {
+                eprintln("not pondering");
+                return;
+            }
+
+            m_searcher.ponderhit(createLimiter(*m_ponderLimits, startTime));
+            m_ponderLimits.reset();
+        }
+
         //TODO refactor
         void UciHandler::handleSetoption(std::span<const std::string_view> args) {
             if (m_searcher.searching()) {
@@ -614,6 +724,24 @@ namespace stormphrax {
                     }
 
                     m_searcher.newGame();
+                } else if (name == "hashscrub") {
+                    if (!value.empty()) {
+                        if (const auto newHashScrub = util::tryParseBool(value)) {
+                            opts::mutableOpts().hashScrub = *newHashScrub;
+                        }
+                    }
+                } else if (name == "preservehashonresize") {
+                    if (!value.empty()) {
+                        if (const auto newPreserveHash = util::tryParseBool(value)) {
+                            opts::mutableOpts().preserveHashOnResize = *newPreserveHash;
+                        }
+                    }
+                } else if (name == "ttevalwrites") {
+                    if (!value.empty()) {
+                        if (const auto newTtEvalWrites = util::tryParseBool(value)) {
+                            opts::mutableOpts().ttEvalWrites = *newTtEvalWrites;
+                        }
+                    }
                 } else if (name == "threads") {
                     if (!value.empty()) {
                         if (const auto newThreads = util::tryParse<u32>(value)) {
@@ -621,6 +749,20 @@ namespace stormphrax {
                             m_searcher.setThreads(opts::kThreadCountRange.clamp(*newThreads));
                         }
                     }
+                } else if (name == "numa") {
+                    if (const auto newNumaMode = util::numa::tryParseMode(value)) {
+                        m_searcher.setNumaMode(*newNumaMode);
+                    } else {
+                        eprintln("invalid NUMA mode {}", value);
+                    }
+                } else if (name == "smpmode") {
+                    if (value == "lazy") {
+                        opts::mutableOpts().smpMode = opts::SmpMode::kLazy;
+                    } else if (value == "abdada") {
+                        opts::mutableOpts().smpMode = opts::SmpMode::kAbdada;
+                    } else {
+                        eprintln("invalid SMP mode {}", value);
+                    }
                 } else if (name == "multipv") {
                     if (!value.empty()) {
                         if (const auto newMultiPv = util::tryParse<i32>(value)) {
@@ -652,6 +794,18 @@ namespace stormphrax {
                             opts::mutableOpts().showCurrMove = *newShowCurrMove;
                         }
                     }
+                } else if (name == "ponder") {
+                    if (!value.empty()) {
+                        if (const auto newPonder = util::tryParseBool(value)) {
+                            opts::mutableOpts().ponder = *newPonder;
+                        }
+                    }
+                } else if (name == "showstartlatency") {
+                    if (!value.empty()) {
+                        if (const auto newShowStartLatency = util::tryParseBool(value)) {
+                            opts::mutableOpts().showStartLatency = *newShowStartLatency;
+                        }
+                    }
                 } else if (name == "move overhead") {
                     if (!value.empty()) {
                         if (const auto newMoveOverhead = util::tryParse<i32>(value)) {
@@ -703,6 +857,13 @@ namespace stormphrax {
                             eval::loadNetwork(value);
                         }
                     }
+                } else if (name == "sharednetwork") {
+                    if (!value.empty()) {
+                        if (const auto newSharedNetwork = util::tryParseBool(value)) {
+                            opts::mutableOpts().sharedNetwork = *newSharedNetwork;
+                            eval::setNetworkSharing(*newSharedNetwork);
+                        }
+                    }
                 }
 #if SP_EXTERNAL_TUNE
                 else if (auto* param = lookupTunableParam(name))
@@ -825,46 +986,175 @@ namespace stormphrax {
                 return;
             }
 
-            i32 depth = bench::kDefaultBenchDepth;
-            usize ttSize = bench::kDefaultBenchTtSize;
+            if (!args.empty() && args[0] == "tt") {
+                usize ttSize = bench::kDefaultTtBenchSize;
+                usize keyCount = bench::kDefaultTtBenchKeys;
 
-            if (args.size() > 0) {
-                if (const auto newDepth = util::tryParse<u32>(args[0])) {
-                    depth = static_cast<i32>(*newDepth);
-                } else {
-                    println("info string invalid depth {}", args[0]);
+                if (args.size() > 1 && !util::tryParse(ttSize, args[1])) {
+                    eprintln("invalid tt size {}", args[1]);
                     return;
                 }
+
+                if (args.size() > 2 && !util::tryParse(keyCount, args[2])) {
+                    eprintln("invalid key count {}", args[2]);
+                    return;
+                }
+
+                bench::runTt(kTtSizeMibRange.clamp(ttSize), std::max<usize>(keyCount, 1));
+                return;
             }
 
-            if (args.size() > 1) {
-                if (const auto newThreads = util::tryParse<u32>(args[1])) {
-                    if (*newThreads > 1) {
-                        println("info string multiple search threads not yet supported, using 1");
+            if (!args.empty() && args[0] == "perf") {
+                i32 depth = bench::kDefaultBenchDepth;
+
+                if (args.size() > 1) {
+                    if (const auto newDepth = util::tryParse<u32>(args[1])) {
+                        depth = std::clamp(static_cast<i32>(*newDepth), 1, kMaxDepth);
+                    } else {
+                        eprintln("invalid depth {}", args[1]);
+                        return;
                     }
-                } else {
-                    println("info string invalid thread count {}", args[1]);
-                    return;
                 }
+
+                bench::runPerf(m_searcher, depth);
+                return;
             }
 
-            if (args.size() > 2) {
-                if (const auto newTtSize = util::tryParse<usize>(args[2])) {
-                    ttSize = static_cast<i32>(*newTtSize);
-                } else {
-                    println("info string invalid tt size {}", args[2]);
-                    return;
+            if (!args.empty() && args[0] == "smp") {
+                // bench smp [depth <depth>] [reps <reps>] [threads <count>...]
+                bench::SmpBenchConfig config{};
+
+                for (usize i = 1; i < args.size(); ++i) {
+                    if (args[i] == "depth" && ++i < args.size()) {
+                        if (const auto depth = util::tryParse<u32>(args[i])) {
+                            config.depth = std::clamp(static_cast<i32>(*depth), 1, kMaxDepth);
+                        } else {
+                            eprintln("invalid depth {}", args[i]);
+                            return;
+                        }
+                    } else if (args[i] == "reps" && ++i < args.size()) {
+                        if (const auto reps = util::tryParse<u32>(args[i])) {
+                            config.reps = std::max<u32>(*reps, 1);
+                        } else {
+                            eprintln("invalid rep count {}", args[i]);
+                            return;
+                        }
+                    } else if (args[i] == "threads") {
+                        while (i + 1 < args.size()) {
+                            if (const auto threads = util::tryParse<u32>(args[i + 1])) {
+                                config.threadCounts.push_back(opts::kThreadCountRange.clamp(*threads));
+                                ++i;
+                            } else {
+                                break;
+                            }
+                        }
+                    } else {
+                        eprintln("invalid smp bench argument {}", args[i]);
+                        return;
+                    }
+                }
+
+                if (config.threadCounts.empty()) {
+                    config.threadCounts.assign(
+                        bench::kDefaultSmpBenchThreadCounts.begin(),
+                        bench::kDefaultSmpBenchThreadCounts.end()
+                    );
+                }
+
+                bench::runSmp(m_searcher, config);
+                return;
+            }
+
+            bench::BenchConfig config{};
+            usize ttSize = bench::kDefaultBenchTtSize;
+
+            if (args.empty() || util::tryParse<u32>(args[0])) {
+                // positional form, bench [depth] [threads] [tt size]
+                if (args.size() > 0) {
+                    config.depth = static_cast<i32>(*util::tryParse<u32>(args[0]));
+                }
+
+                if (args.size() > 1) {
+                    if (const auto newThreads = util::tryParse<u32>(args[1])) {
+                        config.threads = opts::kThreadCountRange.clamp(*newThreads);
+                    } else {
+                        println("info string invalid thread count {}", args[1]);
+                        return;
+                    }
+                }
+
+                if (args.size() > 2) {
+                    if (const auto newTtSize = util::tryParse<usize>(args[2])) {
+                        ttSize = static_cast<i32>(*newTtSize);
+                    } else {
+                        println("info string invalid tt size {}", args[2]);
+                        return;
+                    }
+                }
+            } else {
+                // bench [depth <depth>] [nodes <nodes>] [reps <reps>] [threads <threads>]
+                //       [hash <MiB>] [file <EPD/FEN file>] [json <output file>]
+                for (usize i = 0; i < args.size(); ++i) {
+                    if (i + 1 >= args.size()) {
+                        eprintln("missing value for bench argument {}", args[i]);
+                        return;
+                    }
+
+                    const auto key = args[i];
+                    const auto value = args[++i];
+
+                    if (key == "depth") {
+                        if (const auto depth = util::tryParse<u32>(value)) {
+                            config.depth = static_cast<i32>(*depth);
+                        } else {
+                            eprintln("invalid depth {}", value);
+                            return;
+                        }
+                    } else if (key == "nodes") {
+                        if (const auto nodes = util::tryParse<usize>(value); nodes && *nodes > 0) {
+                            config.nodes = *nodes;
+                        } else {
+                            eprintln("invalid node count {}", value);
+                            return;
+                        }
+                    } else if (key == "reps") {
+                        if (const auto reps = util::tryParse<u32>(value)) {
+                            config.reps = std::max<u32>(*reps, 1);
+                        } else {
+                            eprintln("invalid rep count {}", value);
+                            return;
+                        }
+                    } else if (key == "threads") {
+                        if (const auto threads = util::tryParse<u32>(value)) {
+                            config.threads = opts::kThreadCountRange.clamp(*threads);
+                        } else {
+                            eprintln("invalid thread count {}", value);
+                            return;
+                        }
+                    } else if (key == "hash") {
+                        if (const auto newTtSize = util::tryParse<usize>(value)) {
+                            ttSize = kTtSizeMibRange.clamp(*newTtSize);
+                        } else {
+                            eprintln("invalid tt size {}", value);
+                            return;
+                        }
+                    } else if (key == "file" || key == "epd") {
+                        config.fenFile = std::string{value};
+                    } else if (key == "json") {
+                        config.jsonFile = std::string{value};
+                    } else {
+                        eprintln("invalid bench argument {}", key);
+                        return;
+                    }
                 }
             }
 
             m_searcher.setTtSize(ttSize);
             println("info string set tt size to {} MiB", ttSize);
 
-            if (depth == 0) {
-                depth = 1;
-            }
+            config.depth = std::clamp(config.depth, 1, kMaxDepth);
 
-            bench::run(m_searcher, depth);
+            bench::run(m_searcher, config);
         }
 
         void UciHandler::handleProbeWdl() {
@@ -899,6 +1189,71 @@ namespace stormphrax {
         void UciHandler::handleWait() {
             m_searcher.waitForStop();
         }
+
+        void UciHandler::handleTtStats(std::span<const std::string_view> args) {
+            if (m_searcher.searching()) {
+                eprintln("still searching");
+                return;
+            }
+
+            usize sampleClusters = 10000;
+
+            if (!args.empty() && !util::tryParse(sampleClusters, args[0])) {
+                eprintln("invalid sample size {}", args[0]);
+                return;
+            }
+
+            m_searcher.printTtStats(sampleClusters);
+        }
+
+        void UciHandler::handleSaveState(std::span<const std::string_view> args) {
+            if (m_searcher.searching()) {
+                eprintln("still searching");
+                return;
+            }
+
+            if (args.empty()) {
+                eprintln("missing state file path");
+                return;
+            }
+
+            m_searcher.saveState(joinArgs(args));
+        }
+
+        void UciHandler::handleLoadState(std::span<const std::string_view> args) {
+            if (m_searcher.searching()) {
+                eprintln("still searching");
+                return;
+            }
+
+            if (args.empty()) {
+                eprintln("missing state file path");
+                return;
+            }
+
+            m_searcher.loadState(joinArgs(args));
+        }
+
+        void UciHandler::handleTrace(std::span<const std::string_view> args) {
+            if (m_searcher.searching()) {
+                eprintln("still searching");
+                return;
+            }
+
+            if (!tracer::kEnabled) {
+                eprintln("tracing not compiled in, build with SP_TRACE");
+                return;
+            }
+
+            if (!args.empty() && args[0] == "clear") {
+                tracer::clear();
+                println("info string cleared trace");
+            } else if (args.size() > 1 && args[0] == "dump") {
+                tracer::dump(joinArgs(args.subspan(1)));
+            } else {
+                eprintln("usage: trace dump <path> | trace clear");
+            }
+        }
     } // namespace
 
 #if SP_EXTERNAL_TUNE
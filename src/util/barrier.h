@@ -22,10 +22,14 @@
 
 #include <atomic>
 #include <cassert>
-#include <condition_variable>
-#include <mutex>
+#include <thread>
+
+#include "futex.h"
 
 namespace stormphrax::util {
+    // Spins briefly, then sleeps on a futex. Waking the search threads for
+    // a go usually takes a few microseconds, so this avoids paying for a
+    // mutex and condition variable round trip in the common case
     class Barrier {
     public:
         explicit Barrier(i64 expected) {
@@ -38,34 +42,65 @@ namespace stormphrax::util {
 
             m_total.store(expected, std::memory_order::seq_cst);
             m_current.store(expected, std::memory_order::seq_cst);
+
+            // spinning only helps if every thread can be running at once
+            m_spin = expected <= static_cast<i64>(std::thread::hardware_concurrency());
         }
 
         void arriveAndWait() {
-            std::unique_lock lock{m_waitMutex};
+            // cannot change until every thread, including this one, has arrived
+            const auto phase = m_phase.load(std::memory_order::acquire);
 
-            const auto current = --m_current;
+            if (m_current.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+                m_current.store(m_total.load(std::memory_order::relaxed), std::memory_order::relaxed);
 
-            if (current > 0) {
-                const auto phase = m_phase.load(std::memory_order::relaxed);
-                m_waitSignal.wait(lock, [this, phase] {
-                    return (phase - m_phase.load(std::memory_order::acquire)) < 0;
-                });
-            } else {
-                const auto total = m_total.load(std::memory_order::acquire);
-                m_current.store(total, std::memory_order::release);
+                m_phase.store(phase + 1, std::memory_order::seq_cst);
 
-                ++m_phase;
+                if (m_sleepers.load(std::memory_order::seq_cst) > 0) {
+                    futex::wakeAll(m_phase);
+                }
 
-                m_waitSignal.notify_all();
+                return;
             }
+
+            if (m_spin) {
+                for (u32 i = 0; i < kSpinIterations; ++i) {
+                    if (m_phase.load(std::memory_order::acquire) != phase) {
+                        return;
+                    }
+
+                    pause();
+                }
+            }
+
+            m_sleepers.fetch_add(1, std::memory_order::seq_cst);
+
+            // seq_cst pairs with the waker's store to m_phase then load of m_sleepers
+            while (m_phase.load(std::memory_order::seq_cst) == phase) {
+                futex::wait(m_phase, phase);
+            }
+
+            m_sleepers.fetch_sub(1, std::memory_order::relaxed);
         }
 
     private:
+        // roughly 20-50 us, depending on the latency of pause
+        static constexpr u32 kSpinIterations = 1024;
+
+        static inline void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
         std::atomic<i64> m_total{};
         std::atomic<i64> m_current{};
-        std::atomic<i64> m_phase{};
 
-        std::mutex m_waitMutex{};
-        std::condition_variable m_waitSignal{};
+        std::atomic<u32> m_phase{};
+        std::atomic<u32> m_sleepers{};
+
+        bool m_spin{};
     };
 } // namespace stormphrax::util
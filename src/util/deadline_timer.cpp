@@ -0,0 +1,81 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "deadline_timer.h"
+
+#include <chrono>
+
+namespace stormphrax::util {
+    DeadlineTimer::DeadlineTimer(std::function<void()> callback) :
+            m_callback{std::move(callback)} {}
+
+    DeadlineTimer::~DeadlineTimer() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+
+        {
+            const std::unique_lock lock{m_mutex};
+            m_quit = true;
+        }
+
+        m_signal.notify_one();
+        m_thread.join();
+    }
+
+    void DeadlineTimer::arm(Instant deadline) {
+        {
+            const std::unique_lock lock{m_mutex};
+
+            m_deadline = deadline;
+
+            if (!m_thread.joinable()) {
+                m_thread = std::thread{[this] { run(); }};
+            }
+        }
+
+        m_signal.notify_one();
+    }
+
+    void DeadlineTimer::disarm() {
+        const std::unique_lock lock{m_mutex};
+        m_deadline.reset();
+    }
+
+    void DeadlineTimer::run() {
+        std::unique_lock lock{m_mutex};
+
+        while (!m_quit) {
+            if (!m_deadline) {
+                m_signal.wait(lock);
+                continue;
+            }
+
+            // futex timeouts are accurate to well under a millisecond
+            if (const auto remaining = -m_deadline->elapsed(); remaining > 0.0) {
+                m_signal.wait_for(lock, std::chrono::duration<f64>(remaining));
+                continue;
+            }
+
+            m_deadline.reset();
+
+            // called with the lock held, so that disarm() can wait for it
+            m_callback();
+        }
+    }
+} // namespace stormphrax::util
@@ -0,0 +1,61 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "timer.h"
+
+namespace stormphrax::util {
+    // Runs a callback on a dedicated thread once a deadline passes. The thread
+    // is started on first use and sleeps on a condition variable in between
+    class DeadlineTimer {
+    public:
+        explicit DeadlineTimer(std::function<void()> callback);
+        ~DeadlineTimer();
+
+        DeadlineTimer(const DeadlineTimer&) = delete;
+        DeadlineTimer(DeadlineTimer&&) = delete;
+
+        // Replaces any pending deadline. Fires immediately if it has already passed
+        void arm(Instant deadline);
+        // Once this returns, the callback is not running and will not run
+        // until the timer is armed again
+        void disarm();
+
+    private:
+        void run();
+
+        std::function<void()> m_callback;
+
+        std::mutex m_mutex{};
+        std::condition_variable m_signal{};
+
+        std::optional<Instant> m_deadline{};
+        bool m_quit{};
+
+        std::thread m_thread{};
+    };
+} // namespace stormphrax::util
@@ -0,0 +1,61 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <atomic>
+#include <limits>
+
+#ifdef __linux__
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace stormphrax::util::futex {
+    static_assert(sizeof(std::atomic<u32>) == sizeof(u32));
+
+    // Blocks while word == expected. May return spuriously
+    inline void wait(std::atomic<u32>& word, u32 expected) {
+#ifdef __linux__
+        // libstdc++'s atomic wait adds its own spinning and bookkeeping on
+        // top of the futex, which costs a lot when the machine is oversubscribed
+        syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        word.wait(expected, std::memory_order::acquire);
+#endif
+    }
+
+    inline void wakeAll(std::atomic<u32>& word) {
+#ifdef __linux__
+        syscall(
+            SYS_futex,
+            reinterpret_cast<u32*>(&word),
+            FUTEX_WAKE_PRIVATE,
+            std::numeric_limits<i32>::max(),
+            nullptr,
+            nullptr,
+            0
+        );
+#else
+        word.notify_all();
+#endif
+    }
+} // namespace stormphrax::util::futex
@@ -0,0 +1,241 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "large_pages.h"
+
+#include "align.h"
+
+#ifdef __linux__
+    #include <fstream>
+    #include <string>
+
+    #include "parse.h"
+#endif
+
+#ifdef __linux__
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace stormphrax::util {
+    namespace {
+#ifdef __linux__
+        constexpr usize k2Mib = usize{2} * 1024 * 1024;
+        constexpr usize k1Gib = usize{1024} * 1024 * 1024;
+
+    #ifndef MAP_HUGE_SHIFT
+        constexpr i32 kMapHugeShift = 26;
+    #else
+        constexpr i32 kMapHugeShift = MAP_HUGE_SHIFT;
+    #endif
+
+        constexpr i32 kMapHuge2Mib = 21 << kMapHugeShift;
+        constexpr i32 kMapHuge1Gib = 30 << kMapHugeShift;
+
+        enum class ThpMode : u8 {
+            kNever = 0,
+            kMadvise,
+            kAlways,
+        };
+
+        // the selected mode is bracketed, e.g. "always [madvise] never"
+        ThpMode thpMode() {
+            std::ifstream stream{"/sys/kernel/mm/transparent_hugepage/enabled"};
+
+            std::string line{};
+            std::getline(stream, line);
+
+            if (line.find("[always]") != std::string::npos) {
+                return ThpMode::kAlways;
+            } else if (line.find("[madvise]") != std::string::npos) {
+                return ThpMode::kMadvise;
+            }
+
+            // also covers kernels without THP support
+            return ThpMode::kNever;
+        }
+
+        inline usize roundUp(usize size, usize multiple) {
+            return (size + multiple - 1) / multiple * multiple;
+        }
+
+        void* mapExplicitHugePages(usize size, i32 pageSizeFlag) {
+            auto* ptr =
+                mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pageSizeFlag, -1, 0);
+            return ptr == MAP_FAILED ? nullptr : ptr;
+        }
+
+        // overallocates by one huge page, then trims the ends off to get a 2 MiB-aligned mapping
+        void* mapAligned(usize size) {
+            const auto mappedSize = size + k2Mib;
+
+            auto* mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (mapped == MAP_FAILED) {
+                return nullptr;
+            }
+
+            const auto mappedAddr = reinterpret_cast<std::uintptr_t>(mapped);
+            const auto alignedAddr = roundUp(mappedAddr, k2Mib);
+
+            const auto head = alignedAddr - mappedAddr;
+            const auto tail = mappedSize - head - size;
+
+            if (head > 0) {
+                munmap(mapped, head);
+            }
+
+            if (tail > 0) {
+                munmap(reinterpret_cast<void*>(alignedAddr + size), tail);
+            }
+
+            return reinterpret_cast<void*>(alignedAddr);
+        }
+#endif
+    } // namespace
+
+    PageAllocation allocHugePages(usize size, [[maybe_unused]] usize alignment) {
+        PageAllocation allocation{};
+
+#ifdef __linux__
+        if (size >= k1Gib && size % k1Gib == 0) {
+            if (auto* ptr = mapExplicitHugePages(size, kMapHuge1Gib)) {
+                allocation.ptr = ptr;
+                allocation.size = size;
+                allocation.pageSize = PageSize::kHuge1Gib;
+
+                return allocation;
+            }
+        }
+
+        const auto rounded = roundUp(size, k2Mib);
+
+        if (auto* ptr = mapExplicitHugePages(rounded, kMapHuge2Mib)) {
+            allocation.ptr = ptr;
+            allocation.size = rounded;
+            allocation.pageSize = PageSize::kHuge2Mib;
+
+            return allocation;
+        }
+
+        if (auto* ptr = mapAligned(rounded)) {
+            allocation.ptr = ptr;
+            allocation.size = rounded;
+            allocation.pageSize = PageSize::kSmall;
+
+            // madvise() succeeds even if THP is disabled
+            if (thpMode() != ThpMode::kNever && madvise(ptr, rounded, MADV_HUGEPAGE) == 0) {
+                allocation.pageSize = PageSize::kTransparentHuge;
+            }
+
+            return allocation;
+        }
+#else
+        allocation.ptr = alignedAlloc<std::byte>(alignment, size);
+        allocation.size = size;
+        allocation.pageSize = PageSize::kSmall;
+#endif
+
+        return allocation;
+    }
+
+    void freeHugePages(const PageAllocation& allocation) {
+        if (!allocation.ptr) {
+            return;
+        }
+
+#ifdef __linux__
+        munmap(allocation.ptr, allocation.size);
+#else
+        alignedFree(allocation.ptr);
+#endif
+    }
+
+    void discardPages([[maybe_unused]] void* ptr, [[maybe_unused]] usize size) {
+#ifdef __linux__
+        const auto pageSize = static_cast<usize>(sysconf(_SC_PAGESIZE));
+
+        const auto begin = (reinterpret_cast<usize>(ptr) + pageSize - 1) / pageSize * pageSize;
+        const auto end = (reinterpret_cast<usize>(ptr) + size) / pageSize * pageSize;
+
+        if (end > begin) {
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        }
+#endif
+    }
+
+    std::optional<usize> transparentHugeBytes([[maybe_unused]] const PageAllocation& allocation) {
+#ifdef __linux__
+        std::ifstream stream{"/proc/self/smaps"};
+
+        if (!stream) {
+            return {};
+        }
+
+        const auto begin = reinterpret_cast<usize>(allocation.ptr);
+        const auto end = begin + allocation.size;
+
+        usize total{};
+        bool inRange = false;
+
+        // the kernel may have split the allocation into several mappings
+        for (std::string line{}; std::getline(stream, line);) {
+            const auto dash = line.find('-');
+            const auto space = line.find(' ');
+
+            // mapping header lines look like "7f1234560000-7f1234580000 rw-p ..."
+            if (dash != std::string::npos && space != std::string::npos && dash < space) {
+                const auto mapBegin = tryParse<usize>(std::string_view{line}.substr(0, dash), 16);
+                const auto mapEnd = tryParse<usize>(std::string_view{line}.substr(dash + 1, space - dash - 1), 16);
+
+                if (mapBegin && mapEnd) {
+                    inRange = *mapBegin >= begin && *mapEnd <= end;
+                    continue;
+                }
+            }
+
+            if (inRange && line.starts_with("AnonHugePages:")) {
+                const auto value = std::string_view{line}.substr(line.find(':') + 1);
+                const auto first = value.find_first_not_of(' ');
+                const auto last = value.find(' ', first);
+
+                if (const auto kib = tryParse<usize>(value.substr(first, last - first))) {
+                    total += *kib * 1024;
+                }
+            }
+        }
+
+        return total;
+#else
+        return {};
+#endif
+    }
+
+    std::string_view pageSizeName(PageSize pageSize) {
+        switch (pageSize) {
+            case PageSize::kTransparentHuge:
+                return "requested transparent huge pages";
+            case PageSize::kHuge2Mib:
+                return "2 MiB huge pages";
+            case PageSize::kHuge1Gib:
+                return "1 GiB huge pages";
+            default:
+                return "default pages";
+        }
+    }
+} // namespace stormphrax::util
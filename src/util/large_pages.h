@@ -0,0 +1,58 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <optional>
+#include <string_view>
+
+namespace stormphrax::util {
+    enum class PageSize : u8 {
+        kSmall = 0,
+        // madvise()'d with THP enabled, the kernel may or may not actually
+        // back it with huge pages, see transparentHugeBytes()
+        kTransparentHuge,
+        kHuge2Mib,
+        kHuge1Gib,
+    };
+
+    struct PageAllocation {
+        void* ptr{};
+        usize size{};
+        PageSize pageSize{PageSize::kSmall};
+    };
+
+    // Tries, in order: explicit 1 GiB pages (only if the size is a multiple of 1 GiB),
+    // explicit 2 MiB pages, then a 2 MiB-aligned mapping with transparent huge pages
+    // requested. Elsewhere, falls back to a plain aligned allocation. ptr is null if
+    // all of them fail. Memory is not guaranteed to be zeroed.
+    [[nodiscard]] PageAllocation allocHugePages(usize size, usize alignment);
+    void freeHugePages(const PageAllocation& allocation);
+
+    [[nodiscard]] std::string_view pageSizeName(PageSize pageSize);
+
+    // How much of an allocation is currently backed by transparent huge pages, according to
+    // /proc/self/smaps. Only meaningful once the memory has been touched. Empty if unavailable
+    [[nodiscard]] std::optional<usize> transparentHugeBytes(const PageAllocation& allocation);
+
+    // Hands the whole pages within [ptr, ptr + size) of a private anonymous mapping back
+    // to the OS, which then read back as zero. No-op elsewhere, as the memory stays valid
+    void discardPages(void* ptr, usize size);
+} // namespace stormphrax::util
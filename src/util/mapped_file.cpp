@@ -0,0 +1,112 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mapped_file.h"
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #include <fstream>
+#endif
+
+namespace stormphrax::util {
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& path) {
+        close();
+
+#ifdef __linux__
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info{};
+
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        const auto size = static_cast<usize>(info.st_size);
+
+        // mmap() rejects empty mappings
+        if (size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        auto* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (ptr == MAP_FAILED) {
+            return false;
+        }
+
+        madvise(ptr, size, MADV_SEQUENTIAL);
+
+        m_data = static_cast<const std::byte*>(ptr);
+        m_size = size;
+        m_mapped = true;
+
+        return true;
+#else
+        std::ifstream stream{path, std::ios::binary | std::ios::ate};
+
+        if (!stream) {
+            return false;
+        }
+
+        m_buffer.resize(static_cast<usize>(stream.tellg()));
+
+        stream.seekg(0);
+        stream.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+
+        if (!stream) {
+            m_buffer.clear();
+            return false;
+        }
+
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+
+        return true;
+#endif
+    }
+
+    void MappedFile::close() {
+#ifdef __linux__
+        if (m_mapped) {
+            munmap(const_cast<std::byte*>(m_data), m_size);
+        }
+#endif
+
+        m_data = nullptr;
+        m_size = 0;
+        m_mapped = false;
+
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+    }
+} // namespace stormphrax::util
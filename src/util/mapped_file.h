@@ -0,0 +1,55 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace stormphrax::util {
+    // Read-only view of a whole file. mmap()'d on Linux, where pages are only
+    // faulted in as they are touched, and read into memory elsewhere
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+
+        [[nodiscard]] bool open(const std::string& path);
+        void close();
+
+        [[nodiscard]] inline std::span<const std::byte> data() const {
+            return {m_data, m_size};
+        }
+
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+    private:
+        const std::byte* m_data{};
+        usize m_size{};
+
+        bool m_mapped{};
+        std::vector<std::byte> m_buffer{};
+    };
+} // namespace stormphrax::util
@@ -0,0 +1,244 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "numa.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "parse.h"
+#include "split.h"
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace stormphrax::util::numa {
+    namespace {
+        struct Node {
+            u32 id{};
+            std::vector<u32> cpus{};
+        };
+
+        // parses kernel cpu/node list syntax, e.g. "0-15,32-47"
+        std::vector<u32> parseList(std::string_view str) {
+            std::vector<u32> result{};
+
+            std::vector<std::string_view> ranges{};
+            split::split(ranges, str, ',');
+
+            for (const auto range : ranges) {
+                const auto dash = range.find('-');
+
+                if (dash == std::string_view::npos) {
+                    if (const auto value = util::tryParse<u32>(range)) {
+                        result.push_back(*value);
+                    }
+                    continue;
+                }
+
+                const auto first = util::tryParse<u32>(range.substr(0, dash));
+                const auto last = util::tryParse<u32>(range.substr(dash + 1));
+
+                if (!first || !last) {
+                    continue;
+                }
+
+                for (auto value = *first; value <= *last; ++value) {
+                    result.push_back(value);
+                }
+            }
+
+            return result;
+        }
+
+        std::string readLine(const std::string& path) {
+            std::ifstream stream{path};
+
+            std::string line{};
+            std::getline(stream, line);
+
+            return line;
+        }
+
+#ifdef __linux__
+        struct InheritedMask {
+            cpu_set_t cpus{};
+            bool valid{};
+        };
+
+        // The affinity mask the process started with (e.g. from taskset or a cpuset),
+        // which pinning must stay within. Captured before any thread is pinned
+        const InheritedMask& inheritedMask() {
+            static const auto s_mask = [] {
+                InheritedMask mask{};
+                CPU_ZERO(&mask.cpus);
+                mask.valid = sched_getaffinity(0, sizeof(cpu_set_t), &mask.cpus) == 0;
+                return mask;
+            }();
+
+            return s_mask;
+        }
+#endif
+
+        std::vector<Node> detectNodes() {
+            std::vector<Node> nodes{};
+
+#ifdef __linux__
+            const auto& inherited = inheritedMask();
+
+            for (const auto id : parseList(readLine("/sys/devices/system/node/online"))) {
+                auto cpus = parseList(readLine(fmt::format("/sys/devices/system/node/node{}/cpulist", id)));
+
+                if (inherited.valid) {
+                    std::erase_if(cpus, [&](u32 cpu) {
+                        return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &inherited.cpus);
+                    });
+                }
+
+                // skip memory-only nodes, and nodes the process may not run on
+                if (!cpus.empty()) {
+                    nodes.push_back({id, std::move(cpus)});
+                }
+            }
+#endif
+
+            return nodes;
+        }
+
+        const std::vector<Node>& nodes() {
+            static const auto s_nodes = detectNodes();
+            return s_nodes;
+        }
+    } // namespace
+
+    std::optional<Mode> tryParseMode(std::string_view str) {
+        if (str == "auto") {
+            return Mode::kAuto;
+        } else if (str == "on") {
+            return Mode::kOn;
+        } else if (str == "off") {
+            return Mode::kOff;
+        } else {
+            return {};
+        }
+    }
+
+    u32 nodeCount() {
+        return std::max<u32>(nodes().size(), 1);
+    }
+
+    bool enabled(Mode mode) {
+        switch (mode) {
+            case Mode::kOn:
+                return true;
+            case Mode::kOff:
+                return false;
+            default:
+                return nodeCount() > 1;
+        }
+    }
+
+    bool shouldPin(Mode mode, u32 threadCount) {
+        switch (mode) {
+            case Mode::kOn:
+                return true;
+            case Mode::kOff:
+                return false;
+            default:
+                return threadCount > 1 && nodeCount() > 1;
+        }
+    }
+
+    u32 nodeForThread(u32 threadId) {
+        return threadId % nodeCount();
+    }
+
+    bool bindThisThread(u32 node) {
+#ifdef __linux__
+        if (node >= nodes().size()) {
+            return false;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+
+        for (const auto cpu : nodes()[node].cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool unbindThisThread() {
+#ifdef __linux__
+        const auto& inherited = inheritedMask();
+
+        if (!inherited.valid) {
+            return false;
+        }
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &inherited.cpus) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool interleave(void* ptr, usize size) {
+#ifdef __linux__
+        // MPOL_INTERLEAVE from linux/mempolicy.h, which may not be installed
+        constexpr i32 kMpolInterleave = 3;
+
+        constexpr usize kMaxNodes = 1024;
+        constexpr usize kBitsPerWord = sizeof(unsigned long) * 8;
+
+        std::array<unsigned long, kMaxNodes / kBitsPerWord> mask{};
+
+        u32 maxNode = 0;
+
+        for (const auto& node : nodes()) {
+            if (node.id >= kMaxNodes) {
+                continue;
+            }
+
+            mask[node.id / kBitsPerWord] |= 1UL << (node.id % kBitsPerWord);
+            maxNode = std::max(maxNode, node.id);
+        }
+
+        if (nodes().empty()) {
+            return false;
+        }
+
+        // the kernel ignores the last bit of maxnode
+        return syscall(SYS_mbind, ptr, size, kMpolInterleave, mask.data(), maxNode + 2, 0) == 0;
+#else
+        return false;
+#endif
+    }
+} // namespace stormphrax::util::numa
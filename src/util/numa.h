@@ -0,0 +1,57 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <optional>
+#include <string_view>
+
+namespace stormphrax::util::numa {
+    enum class Mode : u8 {
+        kAuto = 0,
+        kOn,
+        kOff,
+    };
+
+    [[nodiscard]] std::optional<Mode> tryParseMode(std::string_view str);
+
+    // Number of NUMA nodes that have CPUs the process is allowed to run on, as reported
+    // by sysfs and the inherited affinity mask. 1 if the topology is unavailable (e.g. not on Linux)
+    [[nodiscard]] u32 nodeCount();
+
+    // auto only enables NUMA handling when there is more than one node
+    [[nodiscard]] bool enabled(Mode mode);
+
+    // Whether threadCount search threads should be pinned to nodes. auto only pins when the
+    // threads span more than one node, so that single threaded engines keep their inherited placement
+    [[nodiscard]] bool shouldPin(Mode mode, u32 threadCount);
+
+    // Node that search thread threadId should run on
+    [[nodiscard]] u32 nodeForThread(u32 threadId);
+
+    // Pins the calling thread to the CPUs of the given node that are in the inherited affinity mask
+    bool bindThisThread(u32 node);
+    // Restores the affinity mask the process started with
+    bool unbindThisThread();
+
+    // Interleaves the pages of [ptr, ptr + size) across all nodes.
+    // Only affects pages that have not yet been touched
+    bool interleave(void* ptr, usize size);
+} // namespace stormphrax::util::numa
@@ -0,0 +1,204 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace stormphrax::util {
+    namespace {
+#ifdef __linux__
+        struct EventConfig {
+            u32 type;
+            u64 config;
+        };
+
+        constexpr u64 cacheEvent(u64 cache, u64 op, u64 result) {
+            return cache | (op << 8) | (result << 16);
+        }
+
+        constexpr std::array<EventConfig, kPerfEventCount> kEventConfigs{{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE,
+             cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {PERF_TYPE_HW_CACHE,
+             cacheEvent(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {PERF_TYPE_HW_CACHE,
+             cacheEvent(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+
+        struct ReadFormat {
+            u64 value;
+            u64 timeEnabled;
+            u64 timeRunning;
+        };
+
+        i32 openEvent(const EventConfig& config) {
+            perf_event_attr attr{};
+
+            attr.size = sizeof(attr);
+            attr.type = config.type;
+            attr.config = config.config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            // this thread only, on any cpu
+            return static_cast<i32>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        std::string paranoidLevel() {
+            std::ifstream stream{"/proc/sys/kernel/perf_event_paranoid"};
+
+            std::string level{};
+            if (!(stream >> level)) {
+                return "unknown";
+            }
+
+            return level;
+        }
+#endif
+    } // namespace
+
+    std::string_view perfEventName(PerfEvent event) {
+        switch (event) {
+            case PerfEvent::kCycles:
+                return "cycles";
+            case PerfEvent::kInstructions:
+                return "instructions";
+            case PerfEvent::kL1dMisses:
+                return "L1D misses";
+            case PerfEvent::kLlcMisses:
+                return "LLC misses";
+            case PerfEvent::kDtlbMisses:
+                return "dTLB misses";
+            case PerfEvent::kBranchMisses:
+                return "branch misses";
+            default:
+                return "<unknown>";
+        }
+    }
+
+    PerfCounters::PerfCounters() {
+        m_fds.fill(-1);
+
+#ifdef __linux__
+        for (usize i = 0; i < kPerfEventCount; ++i) {
+            m_fds[i] = openEvent(kEventConfigs[i]);
+
+            if (m_fds[i] < 0 && m_error.empty()) {
+                m_error = fmt::format(
+                    "failed to open {} counter: {} (perf_event_paranoid = {})",
+                    perfEventName(static_cast<PerfEvent>(i)),
+                    std::strerror(errno),
+                    paranoidLevel()
+                );
+            }
+        }
+#else
+        m_error = "hardware counters are only supported on Linux";
+#endif
+    }
+
+    PerfCounters::~PerfCounters() {
+#ifdef __linux__
+        for (const auto fd : m_fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    void PerfCounters::start() {
+#ifdef __linux__
+        for (const auto fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void PerfCounters::stop() {
+#ifdef __linux__
+        for (const auto fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+#endif
+    }
+
+    std::array<std::optional<u64>, kPerfEventCount> PerfCounters::read() const {
+        std::array<std::optional<u64>, kPerfEventCount> result{};
+
+#ifdef __linux__
+        for (usize i = 0; i < kPerfEventCount; ++i) {
+            if (m_fds[i] < 0) {
+                continue;
+            }
+
+            ReadFormat data{};
+
+            if (::read(m_fds[i], &data, sizeof(data)) != sizeof(data)) {
+                continue;
+            }
+
+            // counter never got scheduled, e.g. no PMU access in this VM
+            if (data.timeRunning == 0) {
+                if (data.timeEnabled == 0) {
+                    result[i] = 0;
+                }
+                continue;
+            }
+
+            if (data.timeRunning < data.timeEnabled) {
+                const auto scale = static_cast<f64>(data.timeEnabled) / static_cast<f64>(data.timeRunning);
+                result[i] = static_cast<u64>(static_cast<f64>(data.value) * scale);
+            } else {
+                result[i] = data.value;
+            }
+        }
+#endif
+
+        return result;
+    }
+
+    bool PerfCounters::anyAvailable() const {
+        for (const auto fd : m_fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+} // namespace stormphrax::util
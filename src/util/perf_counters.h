@@ -0,0 +1,71 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace stormphrax::util {
+    enum class PerfEvent : u8 {
+        kCycles = 0,
+        kInstructions,
+        kL1dMisses,
+        kLlcMisses,
+        kDtlbMisses,
+        kBranchMisses,
+        kCount,
+    };
+
+    constexpr auto kPerfEventCount = static_cast<usize>(PerfEvent::kCount);
+
+    [[nodiscard]] std::string_view perfEventName(PerfEvent event);
+
+    // Hardware counters for the calling thread, user space only. Each event is
+    // opened separately, so one being unsupported or not permitted does not
+    // take the others down with it. Only implemented on Linux.
+    class PerfCounters {
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters(PerfCounters&&) = delete;
+
+        // resets and enables all open counters
+        void start();
+        void stop();
+
+        // scaled up if the kernel had to multiplex counters, empty if unavailable
+        [[nodiscard]] std::array<std::optional<u64>, kPerfEventCount> read() const;
+
+        [[nodiscard]] bool anyAvailable() const;
+
+        // why the first unavailable event could not be opened, empty if all opened
+        [[nodiscard]] inline const std::string& error() const {
+            return m_error;
+        }
+
+    private:
+        std::array<i32, kPerfEventCount> m_fds{};
+        std::string m_error{};
+    };
+} // namespace stormphrax::util
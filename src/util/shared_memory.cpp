@@ -0,0 +1,228 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "shared_memory.h"
+
+#include <string_view>
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace stormphrax::util {
+    namespace {
+        enum class SegmentState : u32 {
+            kInvalid = 0,
+            kReady,
+        };
+
+        struct SegmentHeader {
+            SegmentState state;
+            u32 padding;
+            u64 size;
+        };
+
+        // keeps the data as aligned as the (page aligned) mapping itself
+        constexpr usize kHeaderSize = 64;
+        static_assert(sizeof(SegmentHeader) <= kHeaderSize);
+
+#ifdef __linux__
+        // where glibc's shm_open puts segments. needed to link
+        // a filled segment into place, which shm_* cannot do
+        constexpr std::string_view kShmDir = "/dev/shm";
+
+        std::string shmFile(const std::string& path) {
+            return std::string{kShmDir} + path;
+        }
+
+        // maps an existing (and therefore fully filled) segment read-only
+        std::byte* mapExisting(const std::string& path, usize size, usize mappingSize, bool& missing) {
+            const auto fd = shm_open(path.c_str(), O_RDONLY, 0);
+            missing = fd < 0 && errno == ENOENT;
+
+            if (fd < 0) {
+                return nullptr;
+            }
+
+            struct stat info{};
+
+            if (fstat(fd, &info) != 0) {
+                ::close(fd);
+                return nullptr;
+            }
+
+            // segment names are predictable and /dev/shm is world writable, so anyone
+            // could have created this one. Only segments that nobody but this user
+            // could have written are trusted, as their contents are used unchecked
+            if (info.st_uid != geteuid() || (info.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+                eprintln("shared memory segment {} is not private to this user, not using it", path);
+                ::close(fd);
+                return nullptr;
+            }
+
+            if (static_cast<usize>(info.st_size) != mappingSize) {
+                eprintln("shared memory segment {} has the wrong size", path);
+                ::close(fd);
+                return nullptr;
+            }
+
+            auto* ptr = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+
+            if (ptr == MAP_FAILED) {
+                return nullptr;
+            }
+
+            auto* mapping = static_cast<std::byte*>(ptr);
+            const auto& header = *reinterpret_cast<const SegmentHeader*>(mapping);
+
+            if (header.state != SegmentState::kReady || header.size != size) {
+                eprintln("shared memory segment {} is invalid, remove {} if stale", path, shmFile(path));
+                munmap(ptr, mappingSize);
+                return nullptr;
+            }
+
+            return mapping;
+        }
+#endif
+    } // namespace
+
+    SharedMemory::~SharedMemory() {
+        close();
+    }
+
+    bool SharedMemory::openOrCreate(const std::string& name, usize size, const InitFunc& init) {
+        close();
+
+#ifdef __linux__
+        const auto path = "/" + name;
+        const auto mappingSize = kHeaderSize + size;
+
+        bool missing{};
+
+        if (auto* mapping = mapExisting(path, size, mappingSize, missing)) {
+            m_mapping = mapping;
+            m_mappingSize = mappingSize;
+
+            m_data = m_mapping + kHeaderSize;
+            m_size = size;
+
+            return true;
+        }
+
+        if (!missing) {
+            return false;
+        }
+
+        // the segment is filled under a name private to this process, and only linked
+        // into place once ready. A creator that dies halfway through therefore leaves
+        // nothing behind under the real name for later processes to wait on
+        const auto tempPath = fmt::format("{}.{}.tmp", path, getpid());
+
+        // left behind by an earlier process with the same pid
+        shm_unlink(tempPath.c_str());
+
+        const auto fd = shm_open(tempPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(mappingSize)) != 0) {
+            ::close(fd);
+            shm_unlink(tempPath.c_str());
+            return false;
+        }
+
+        auto* ptr = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (ptr == MAP_FAILED) {
+            shm_unlink(tempPath.c_str());
+            return false;
+        }
+
+        auto* mapping = static_cast<std::byte*>(ptr);
+
+        if (!init({mapping + kHeaderSize, size})) {
+            munmap(ptr, mappingSize);
+            shm_unlink(tempPath.c_str());
+            return false;
+        }
+
+        auto& header = *reinterpret_cast<SegmentHeader*>(mapping);
+
+        header.state = SegmentState::kReady;
+        header.size = size;
+
+        // fails if another process got there first, in which case
+        // its segment is used so that only one copy stays around
+        const auto linked = link(shmFile(tempPath).c_str(), shmFile(path).c_str()) == 0;
+        shm_unlink(tempPath.c_str());
+
+        if (!linked) {
+            munmap(ptr, mappingSize);
+
+            if (errno != EEXIST) {
+                return false;
+            }
+
+            mapping = mapExisting(path, size, mappingSize, missing);
+
+            if (!mapping) {
+                return false;
+            }
+
+            m_created = false;
+        } else {
+            mprotect(ptr, mappingSize, PROT_READ);
+            m_created = true;
+        }
+
+        m_mapping = mapping;
+        m_mappingSize = mappingSize;
+
+        m_data = m_mapping + kHeaderSize;
+        m_size = size;
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void SharedMemory::close() {
+#ifdef __linux__
+        if (m_mapping) {
+            munmap(m_mapping, m_mappingSize);
+        }
+#endif
+
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+
+        m_data = nullptr;
+        m_size = 0;
+
+        m_created = false;
+    }
+} // namespace stormphrax::util
@@ -0,0 +1,73 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <functional>
+#include <span>
+#include <string>
+
+namespace stormphrax::util {
+    // Named shared memory segment, mapped read-only once initialised. The first
+    // process to open a given name creates and fills it, later ones just map it.
+    // Segments outlive the processes that created them (/dev/shm on Linux), so
+    // that engines started later can still reuse them. Segments are private to the
+    // user that created them - ones that another user could have written to are
+    // never mapped, so processes only share with others of the same user. Only
+    // supported on Linux
+    class SharedMemory {
+    public:
+        using InitFunc = std::function<bool(std::span<std::byte>)>;
+
+        SharedMemory() = default;
+        ~SharedMemory();
+
+        SharedMemory(const SharedMemory&) = delete;
+        SharedMemory(SharedMemory&&) = delete;
+
+        // Maps the segment called name, which must be size bytes long. If it does not
+        // exist yet, it is created and filled by init, which may fail. Segments only
+        // appear under their name once filled, so this never waits on another process
+        [[nodiscard]] bool openOrCreate(const std::string& name, usize size, const InitFunc& init);
+        void close();
+
+        [[nodiscard]] inline std::span<const std::byte> data() const {
+            return {m_data, m_size};
+        }
+
+        // whether this process created the segment
+        [[nodiscard]] inline bool created() const {
+            return m_created;
+        }
+
+        SharedMemory& operator=(const SharedMemory&) = delete;
+        SharedMemory& operator=(SharedMemory&&) = delete;
+
+    private:
+        // the mapping, including the header that precedes the data
+        std::byte* m_mapping{};
+        usize m_mappingSize{};
+
+        const std::byte* m_data{};
+        usize m_size{};
+
+        bool m_created{};
+    };
+} // namespace stormphrax::util
@@ -310,6 +310,14 @@ namespace stormphrax::util::simd {
         return impl::dpbusdI32(sum, u, i);
     }
 
+    // one bit per lane
+    template <typename T>
+    SP_ALWAYS_INLINE_NDEBUG inline auto equalMask(Vector<T> a, Vector<T> b) = delete;
+    template <>
+    SP_ALWAYS_INLINE_NDEBUG inline auto equalMask<i32>(Vector<i32> a, Vector<i32> b) {
+        return impl::equalMaskI32(a, b);
+    }
+
     template <typename T>
     SP_ALWAYS_INLINE_NDEBUG inline auto nonzeroMask(Vector<T> v) = delete;
     template <>
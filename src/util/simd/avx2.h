@@ -37,6 +37,9 @@ namespace stormphrax::util::simd {
 
     constexpr std::uintptr_t kAlignment = sizeof(__m256i);
 
+    // architectural vector registers, for register tiling
+    constexpr usize kRegisterCount = 16;
+
     constexpr bool kPackNonSequential = true;
 
     constexpr usize kPackGrouping = 8;
@@ -270,6 +273,11 @@ namespace stormphrax::util::simd {
     #endif
         }
 
+        SP_ALWAYS_INLINE_NDEBUG inline u32 equalMaskI32(VectorI32 a, VectorI32 b) {
+            const auto eq = _mm256_cmpeq_epi32(a, b);
+            return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        }
+
         SP_ALWAYS_INLINE_NDEBUG inline u32 nonzeroMaskU8(VectorU8 v) {
             const auto nz = _mm256_cmpgt_epi32(v, _mm256_setzero_si256());
             return _mm256_movemask_ps(_mm256_castsi256_ps(nz));
@@ -37,6 +37,9 @@ namespace stormphrax::util::simd {
 
     constexpr std::uintptr_t kAlignment = sizeof(__m512i);
 
+    // architectural vector registers, for register tiling
+    constexpr usize kRegisterCount = 32;
+
     constexpr bool kPackNonSequential = true;
 
     constexpr usize kPackGrouping = 8;
@@ -265,6 +268,10 @@ namespace stormphrax::util::simd {
     #endif
         }
 
+        SP_ALWAYS_INLINE_NDEBUG inline u32 equalMaskI32(VectorI32 a, VectorI32 b) {
+            return _mm512_cmpeq_epi32_mask(a, b);
+        }
+
         SP_ALWAYS_INLINE_NDEBUG inline u32 nonzeroMaskU8(VectorU8 v) {
             return _mm512_cmpneq_epi32_mask(v, _mm512_setzero_si512());
         }
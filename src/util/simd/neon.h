@@ -37,6 +37,13 @@ namespace stormphrax::util::simd {
 
     constexpr std::uintptr_t kAlignment = sizeof(int16x8_t);
 
+    // architectural vector registers, for register tiling
+    #if defined(__aarch64__)
+    constexpr usize kRegisterCount = 32;
+    #else
+    constexpr usize kRegisterCount = 16;
+    #endif
+
     constexpr bool kPackNonSequential = false;
 
     constexpr usize kPackGrouping = 1;
@@ -267,6 +274,11 @@ namespace stormphrax::util::simd {
     #endif
         }
 
+        SP_ALWAYS_INLINE_NDEBUG inline u32 equalMaskI32(VectorI32 a, VectorI32 b) {
+            alignas(kAlignment) static constexpr std::array<u32, 4> kMask = {1, 2, 4, 8};
+            return vaddvq_u32(vandq_u32(vceqq_s32(a, b), vld1q_u32(kMask.data())));
+        }
+
         SP_ALWAYS_INLINE_NDEBUG inline u32 nonzeroMaskU8(VectorU8 v) {
             alignas(kAlignment) static constexpr std::array<u32, 4> kMask = {1, 2, 4, 8};
             return vaddvq_u32(vandq_u32(vtstq_u32(v, v), vld1q_u32(kMask.data())));
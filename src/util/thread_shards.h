@@ -0,0 +1,112 @@
+/*
+ * Stormphrax, a UCI chess engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stormphrax is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stormphrax is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stormphrax. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace stormphrax::util {
+    // Per-thread shards of T, for counters that are written without synchronisation by their
+    // own thread and only merged when reported. A thread claims a shard the first time it
+    // needs one, and hands it back for reuse when it exits, so recreating threads does not
+    // grow the shard list. Shards are never freed, so values recorded by exited threads
+    // survive. Each T must have its own registry, all state is static
+    template <typename T>
+    class ThreadShards {
+    public:
+        ThreadShards() = delete;
+
+        [[nodiscard]] static inline T& local() {
+            if (!t_shard) [[unlikely]] {
+                return claim();
+            }
+
+            return *t_shard;
+        }
+
+        // the calling thread's shard, or null if it has not claimed one
+        [[nodiscard]] static inline T* current() {
+            return t_shard;
+        }
+
+        // onCreate(shard, index) is called under the lock for shards that did not exist before
+        template <typename F>
+        static T& claim(F&& onCreate) {
+            const std::unique_lock lock{s_mutex};
+
+            // touch the releaser so that it gets constructed, and destroyed on thread exit
+            static_cast<void>(&t_releaser);
+
+            if (!s_free.empty()) {
+                t_shard = s_free.back();
+                s_free.pop_back();
+            } else {
+                t_shard = s_shards.emplace_back(std::make_unique<T>()).get();
+                onCreate(*t_shard, s_shards.size() - 1);
+            }
+
+            return *t_shard;
+        }
+
+        static T& claim() {
+            return claim([](T&, usize) {});
+        }
+
+        // Calls f with every shard ever created, in creation order, under the lock
+        template <typename F>
+        static void forEach(F&& f) {
+            const std::unique_lock lock{s_mutex};
+
+            for (auto& shard : s_shards) {
+                f(*shard);
+            }
+        }
+
+        [[nodiscard]] static usize count() {
+            const std::unique_lock lock{s_mutex};
+            return s_shards.size();
+        }
+
+        // for modifying a shard consistently with concurrent forEach() calls
+        [[nodiscard]] static std::unique_lock<std::mutex> lock() {
+            return std::unique_lock{s_mutex};
+        }
+
+    private:
+        struct Releaser {
+            ~Releaser() {
+                if (t_shard) {
+                    const std::unique_lock lock{s_mutex};
+                    s_free.push_back(t_shard);
+                    t_shard = nullptr;
+                }
+            }
+        };
+
+        static inline std::mutex s_mutex{};
+        static inline std::vector<std::unique_ptr<T>> s_shards{};
+        static inline std::vector<T*> s_free{};
+
+        static inline thread_local T* t_shard{};
+        static inline thread_local Releaser t_releaser{};
+    };
+} // namespace stormphrax::util